@@ -0,0 +1,44 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+// Test of the library interface: a session solves a circuit built in
+// memory, with the options changed between the calls. The engine that is
+// used is logged on stderr.
+
+#include <iostream>
+#include "../libqubi.hpp"
+
+using std::cout;
+using std::endl;
+
+// Ex x All y: or(x, y), which is true for x=1
+Circuit example() {
+    Circuit c;
+    int x = c.addVar(), y = c.addVar();
+    c.addBlock(Block(Exists, {x}));
+    c.addBlock(Block(Forall, {y}));
+    c.setOutput(c.addGate(Gate(Or, {x, y})));
+    return c;
+}
+
+void solve(Qubi& qubi, const std::string& name) {
+    Circuit c = example();
+    qubi.transform(c);
+    Valuation valuation;
+    bool verdict = qubi.solve(c, valuation);
+    cout << name << ": " << (verdict ? "TRUE" : "FALSE");
+    for (auto& [var, value] : valuation) cout << " " << var << "=" << value;
+    cout << endl;
+}
+
+int main() {
+    Options options;
+    options.example = true;
+    Qubi qubi(options);
+    solve(qubi, "truth tables");
+    qubi.options.garbage = false;
+    solve(qubi, "BDDs without garbage collection");
+    qubi.options.garbage = true;
+    qubi.options.backend = Options::builtinbdd;
+    solve(qubi, "built-in BDDs");
+}
@@ -26,4 +26,246 @@ for x in s*.qcir q*.qcir; do
     diff OUT/test1.txt OUT/test3.txt
 done
 
+# test that quantifier gates (fused with and/or) provide the same result
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi -e $x > OUT/test1.txt
+    ../qubi -u=0 -x=1 -e $x > OUT/test2.txt
+    ../qubi -u=0 -x=2 -e $x > OUT/test3.txt
+    diff OUT/test1.txt OUT/test2.txt
+    diff OUT/test1.txt OUT/test3.txt
+done
+
+# test that partitioned solving provides the same result
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi -e $x > OUT/test1.txt
+    ../qubi -u=0 -m=1 -e $x > OUT/test2.txt
+    ../qubi -u=0 -m=100 -f -e $x > OUT/test3.txt
+    diff OUT/test1.txt OUT/test2.txt
+    diff OUT/test1.txt OUT/test3.txt
+done
+
+# test that the low-peak evaluation order provides the same result
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi -e $x > OUT/test1.txt
+    ../qubi -u=0 -o=1 -e $x > OUT/test2.txt
+    ../qubi -u=0 -o=1 -i=0 -e $x > OUT/test3.txt
+    diff OUT/test1.txt OUT/test2.txt
+    diff OUT/test1.txt OUT/test3.txt
+done
+
+# test that incremental and adaptive quantification provide the same result
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi -e $x > OUT/test1.txt
+    ../qubi -u=0 -a=1 -e $x > OUT/test2.txt
+    ../qubi -u=0 -a=2 -e $x > OUT/test3.txt
+    diff OUT/test1.txt OUT/test2.txt
+    diff OUT/test1.txt OUT/test3.txt
+done
+
+# test that expanding variables over a small node budget provides the same result
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi -e $x > OUT/test1.txt
+    ../qubi -u=0 -n=2 -e $x > OUT/test2.txt
+    diff OUT/test1.txt OUT/test2.txt
+done
+
+# test that the built-in BDD package provides the same result
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi -e $x > OUT/test1.txt
+    ../qubi -u=0 -b=1 -e $x > OUT/test2.txt
+    ../qubi -u=0 -b=1 -a=2 -d=1 -e $x > OUT/test3.txt
+    diff OUT/test1.txt OUT/test2.txt
+    diff OUT/test1.txt OUT/test3.txt
+done
+
+# test that clause-set elimination provides the same result
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi -e $x > OUT/test1.txt
+    ../qubi -z=1000 -e $x > OUT/test2.txt
+    diff OUT/test1.txt OUT/test2.txt
+done
+
+# test that the CEGAR engine provides the same verdict
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi $x > OUT/test1.txt
+    ../qubi -y=1 $x > OUT/test2.txt
+    diff OUT/test1.txt OUT/test2.txt
+done
+
+# test that approximations provide the same result, decided early or not
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi -e $x > OUT/test1.txt
+    ../qubi -u=0 -l=2 -e $x > OUT/test2.txt
+    ../qubi -u=0 -l=100 -e $x > OUT/test3.txt
+    diff OUT/test1.txt OUT/test2.txt
+    diff OUT/test1.txt OUT/test3.txt
+done
+
+# test that the tree-decomposition order and bucket elimination provide the same verdict
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi $x > OUT/test1.txt
+    ../qubi -u=0 -r=3 -a=3 $x > OUT/test2.txt
+    ../qubi -u=0 -r=3 -m=1 -a=3 $x > OUT/test3.txt
+    diff OUT/test1.txt OUT/test2.txt
+    diff OUT/test1.txt OUT/test3.txt
+done
+
+# test that symmetry breaking provides the same verdict
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi $x > OUT/test1.txt
+    ../qubi -j=10 $x > OUT/test2.txt
+    diff OUT/test1.txt OUT/test2.txt
+done
+
+# test that don't-care minimization provides the same result
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi -e $x > OUT/test1.txt
+    ../qubi -u=0 -d=1 -e $x > OUT/test2.txt
+    ../qubi -u=0 -d=2 -i=0 -e $x > OUT/test3.txt
+    diff OUT/test1.txt OUT/test2.txt
+    diff OUT/test1.txt OUT/test3.txt
+done
+
+# test that the swept circuit has the same verdict
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi $x > OUT/test1.txt
+    ../qubi -p -sweep=20 $x > OUT/swept.qcir
+    ../qubi OUT/swept.qcir > OUT/test2.txt
+    diff OUT/test1.txt OUT/test2.txt
+done
+
+# test that the portfolio provides the same verdict
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi $x > OUT/test1.txt
+    ../qubi -portfolio=8 $x > OUT/test2.txt
+    diff OUT/test1.txt OUT/test2.txt
+done
+
+# the prenex configuration fills the BDD table first, miniscoping (-x=2) decides
+../qubi -r=0 -b=1 -t=15 -x=2 portfolio.qcir > OUT/test1.txt
+../qubi -r=0 -b=1 -t=15 -portfolio=2 portfolio.qcir > OUT/test2.txt
+diff OUT/test1.txt OUT/test2.txt
+
+# test that cube-and-conquer provides the same verdict
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi $x > OUT/test1.txt
+    ../qubi -cubes=3 -pool=2 $x > OUT/test2.txt
+    diff OUT/test1.txt OUT/test2.txt
+done
+
+# test that generous limits don't change the verdict
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi $x > OUT/test1.txt
+    ../qubi -timeout=600 -memlimit=65536 $x > OUT/test2.txt
+    diff OUT/test1.txt OUT/test2.txt
+    ../qubi -u=0 -mem=1 $x > OUT/test2.txt
+    diff OUT/test1.txt OUT/test2.txt
+    ../qubi -u=0 -b=1 -mem=1 $x > OUT/test2.txt
+    diff OUT/test1.txt OUT/test2.txt
+done
+
+# test that resuming from the last checkpoint provides the same result and dump
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    rm -f OUT/test.ckpt
+    ../qubi -e $x > OUT/test1.txt
+    ../qubi -u=0 -e -checkpoint=OUT/test.ckpt -period=0 -dump=OUT/dump1.bdd $x > OUT/test2.txt
+    diff OUT/test1.txt OUT/test2.txt
+    if [ -f OUT/test.ckpt ]; then   # not without gates
+        ../qubi -u=0 -e -resume=OUT/test.ckpt -dump=OUT/dump2.bdd $x > OUT/test3.txt
+        diff OUT/test1.txt OUT/test3.txt
+        cmp OUT/dump1.bdd OUT/dump2.bdd
+    fi
+done
+
+# test that a checkpoint with approximations (-l) is not resumed without them
+
+rm -f OUT/test.ckpt
+../qubi -u=0 -l=2 -checkpoint=OUT/test.ckpt -period=0 qbf3.qcir > /dev/null
+../qubi -u=0 -resume=OUT/test.ckpt qbf3.qcir 2>&1 | grep Error
+
+# test that the result cache provides the same verdicts and examples
+
+for x in s*.qcir q*.qcir; do
+    echo $x
+    ../qubi -e $x > OUT/test1.txt
+    ../qubi -u=0 -e -cache=OUT/cache $x > OUT/test2.txt  # stores
+    diff OUT/test1.txt OUT/test2.txt
+    ../qubi -u=0 -e -cache=OUT/cache $x > OUT/test2.txt  # finds
+    diff OUT/test1.txt OUT/test2.txt
+done
+
+# test that batch mode provides the same verdicts
+
+printf "%s\n" s*.qcir q*.qcir > OUT/list.txt
+../qubi -u=0 -batch=OUT/list.txt | cut -d" " -f1,2 > OUT/test1.txt
+for x in s*.qcir q*.qcir; do
+    echo "$x $(../qubi -v=0 $x | cut -d" " -f2)"
+done > OUT/test2.txt
+diff OUT/test1.txt OUT/test2.txt
+
+# test that a worker and a server provide the same verdicts
+
+i=0
+for x in s*.qcir q*.qcir; do
+    printf "job %d %d\n" $i $(wc -c < $x)
+    cat $x
+    i=$((i+1))
+done > OUT/jobs.txt
+i=0
+for x in s*.qcir q*.qcir; do
+    echo "$i $(../qubi -v=0 $x | cut -d" " -f2)"
+    i=$((i+1))
+done > OUT/test1.txt
+../qubi -u=0 -worker < OUT/jobs.txt | cut -d" " -f1,2 > OUT/test2.txt
+diff OUT/test1.txt OUT/test2.txt
+if command -v python3 > /dev/null; then   # as a client of the socket
+    ../qubi -u=0 -v=0 -socket=OUT/qubi.sock &
+    while [ ! -S OUT/qubi.sock ]; do sleep 0.1; done
+    python3 -c 'import socket,sys; s=socket.socket(socket.AF_UNIX); s.connect(sys.argv[1]); s.sendall(sys.stdin.buffer.read()); s.shutdown(socket.SHUT_WR); sys.stdout.write(s.makefile().read())' \
+        OUT/qubi.sock < OUT/jobs.txt | cut -d" " -f1,2 > OUT/test2.txt
+    kill $!
+    diff OUT/test1.txt OUT/test2.txt
+fi
+
+# test the library interface, if it was built (see README): the engine of each call
+
+if [ -f ../libqubi.a ]; then
+    g++ -std=c++17 library.cpp -o OUT/library -L.. -lqubi -lsylvan -lpthread -llace
+    OUT/library 2>&1 | grep -v "^Reordering\|^Quantifying"
+fi
+
 rm -r OUT
@@ -0,0 +1,344 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef BDD_BASE_H
+#define BDD_BASE_H
+
+#include <vector>
+#include <deque>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+
+#include "settings.hpp"
+
+template <class BDD>
+class Bdd_base {
+
+// Bdd_base<BDD> provides the operations that the Solver needs on top of a
+// BDD package. A backend BDD class derives from Bdd_base<BDD> and provides:
+//
+//  BDD(bool), BDD(int)                   constants true/false, variable(i)
+//  isConstant(), ==, +=, *=, ^=, !       tests and connectives
+//  Ite(then, else)                       if-then-else, with this as condition
+//  Restrict(care), Constrain(care)       agree with this where care holds
+//  Quantify(variables, exists)           exists/forall over the cube of variables
+//  AndAbstract(other, variables)         exists variables (this /\ other)
+//  Support()                             variables in the BDD, in increasing order
+//  PickOneCube(variables)                Sylvan's choice of a satisfying valuation
+//  NodeCount()                           size of the BDD
+//  Hash()                                identifies the BDD while it is alive
+//  TopVar(), Then(), Else()              top variable and its cofactors (not constant)
+//  static gc()                           collect unreferenced BDD nodes
+
+public:
+
+/* quantification (see QUANTIFY) */
+
+    BDD UnivAbstract(const std::vector<int>& variables) const  { return Abstract(variables, false); }
+    BDD ExistAbstract(const std::vector<int>& variables) const { return Abstract(variables, true); }
+
+/* approximation: at most bound nodes (-l) */
+
+    BDD OverApprox(size_t bound) const  { return Approx(bound, true); }  // implied by this
+    BDD UnderApprox(size_t bound) const { return Approx(bound, false); } // implies this
+
+/* don't-care minimization (see DONTCARE) */
+
+    BDD Minimize(const BDD& care) const; // agrees with this where care holds
+
+/* folding operations */
+
+    static BDD bigAnd(const std::vector<BDD>&);
+    static BDD bigOr(const std::vector<BDD>&);
+    static BDD bigAndExists(const std::vector<BDD>&, const std::vector<int>& variables);
+
+/* serialization of BDDs that share nodes (checkpoints, -dump) */
+
+    static void Write(std::ostream& out, const std::vector<BDD>& roots);
+    static bool Read(std::istream& in, std::vector<BDD>& roots); // false if malformed
+
+/* statistics */
+
+    const BDD& peak() {
+        if (STATISTICS) {
+            size_t count = self().NodeCount();
+            if (count > PEAK) {
+                PEAK = count;
+                LOG(1, "[peak " << PEAK << "]");
+            }
+        }
+        return self();
+    }
+
+private:
+
+    const BDD& self() const { return static_cast<const BDD&>(*this); }
+    BDD Abstract(const std::vector<int>& variables, bool exists) const;
+    BDD Approx(size_t bound, bool over) const;
+
+    static BDD bigAnd_left2right(const std::vector<BDD>& args);
+    static BDD bigOr_left2right(const std::vector<BDD>& args);
+    static BDD bigAnd_pairwise(const std::vector<BDD>& args);
+    static BDD bigOr_pairwise(const std::vector<BDD>& args);
+};
+
+// Quantify the variables with a single cube (QUANTIFY=0), or one variable
+// at a time (QUANTIFY=1), each time picking the smallest result among the
+// CANDIDATES lowest variables in the support. Adaptive (QUANTIFY=2) continues
+// one at a time while the BDD grows, but takes all remaining variables in a
+// single cube once a step did not increase the node count. Buckets
+// (QUANTIFY=3) takes one variable at a time, highest index first, which
+// follows the elimination order of the tree decomposition (-r=3).
+
+constexpr size_t CANDIDATES = 8;
+
+template <class BDD>
+BDD Bdd_base<BDD>::Abstract(const std::vector<int>& variables, bool exists) const {
+    if (QUANTIFY == 0 || variables.size() <= 1) {
+        BDD result = self().Quantify(variables, exists);
+        result.peak();
+        return result;
+    }
+
+    std::set<int> quantified(variables.begin(), variables.end());
+    std::vector<int> todo; // remaining variables in the support, lowest first
+    for (int x : self().Support())
+        if (quantified.count(x)>0) todo.push_back(x);
+
+    BDD current = self();
+    size_t size = (STATISTICS || QUANTIFY==2 ? current.NodeCount() : 0);
+    size_t peaksize = size;
+    while (todo.size()>0) {
+        size_t best = 0;
+        BDD bestbdd(false);
+        size_t bestsize = 0;
+        const size_t first = (QUANTIFY==3 ? todo.size()-1 : 0); // buckets: only the highest
+        const size_t last = (QUANTIFY==3 ? todo.size() : std::min(todo.size(), CANDIDATES));
+        for (size_t k=first; k<last; k++) {
+            BDD result = current.Quantify(std::vector<int>({todo[k]}), exists);
+            size_t count = result.NodeCount();
+            if (k==first || count<bestsize) {
+                best = k; bestbdd = result; bestsize = count;
+            }
+        }
+        if (STATISTICS) LOG(2, "[" << todo[best] << ": " << bestsize << "]");
+        peaksize = std::max(peaksize, bestsize);
+        current = bestbdd;
+        todo.erase(todo.begin()+best);
+        if (QUANTIFY == 2 && bestsize <= size && todo.size()>1) {
+            current = current.Quantify(todo, exists);
+            if (STATISTICS) LOG(2, "[" << todo.size() << "x: " << current.NodeCount() << "]");
+            break;
+        }
+        size = bestsize;
+    }
+    if (STATISTICS) LOG(2, "[step peak " << peaksize << "]");
+    current.peak();
+    return current;
+}
+
+// Approximate by quantifying variables, exists for an over-approximation
+// and forall for an under-approximation, until at most bound nodes remain.
+// Each step takes the smallest result among the CANDIDATES top variables.
+
+template <class BDD>
+BDD Bdd_base<BDD>::Approx(size_t bound, bool over) const {
+    BDD current = self();
+    while (current.NodeCount() > bound) {
+        std::vector<int> support = current.Support();
+        BDD best(false);
+        size_t bestsize = 0;
+        for (size_t k=0; k<std::min(support.size(), CANDIDATES); k++) {
+            BDD result = current.Quantify(std::vector<int>({support[k]}), over);
+            size_t count = result.NodeCount();
+            if (k==0 || count<bestsize) {
+                best = result; bestsize = count;
+            }
+        }
+        current = best;
+    }
+    return current;
+}
+
+// Use the valuations outside care as don't-cares: restrict (DONTCARE=1) or
+// constrain (DONTCARE=2). Constrain may introduce variables of care, so the
+// result is only accepted if it has fewer nodes.
+
+template <class BDD>
+BDD Bdd_base<BDD>::Minimize(const BDD& care) const {
+    if (DONTCARE == 0 || self().isConstant() || care.isConstant())
+        return self();
+    BDD result = (DONTCARE == 1 ? self().Restrict(care) : self().Constrain(care));
+    if (result.NodeCount() < self().NodeCount())
+        return result;
+    return self();
+}
+
+// TODO: could use parallel reduce (TASKS)
+
+template <class BDD>
+BDD Bdd_base<BDD>::bigAnd(const std::vector<BDD>& args) {
+    if (ITERATE == 0) return bigAnd_left2right(args);
+    if (ITERATE == 1) return bigAnd_pairwise(args);
+    std::cerr << "Internal error: ITERATE value" << ITERATE << std::endl;
+    exit(-1);
+}
+
+template <class BDD>
+BDD Bdd_base<BDD>::bigOr(const std::vector<BDD>& args) {
+    if (ITERATE == 0) return bigOr_left2right(args);
+    if (ITERATE == 1) return bigOr_pairwise(args);
+    std::cerr << "Internal error: ITERATE value" << ITERATE << std::endl;
+    exit(-1);
+}
+
+template <class BDD>
+BDD Bdd_base<BDD>::bigAnd_left2right(const std::vector<BDD>& args) {
+    BDD bdd = BDD(true); // neutral element
+    for (BDD arg: args) {
+        LOG(2,".");
+        bdd *= arg;
+        if (bdd == BDD(false)) break; // absorbing element
+    }
+    return bdd;
+}
+
+template <class BDD>
+BDD Bdd_base<BDD>::bigOr_left2right(const std::vector<BDD>& args) {
+    BDD bdd = BDD(false); // neutral element
+    for (BDD arg: args) {
+        LOG(2,".");
+        bdd += arg;
+        if (bdd == BDD(true)) break; // absorbing element
+    }
+    return bdd;
+}
+
+/* Relational product: exists variables (args[0] /\ ... /\ args[n-1]) */
+
+// Each variable is quantified in the step after which no remaining argument
+// depends on it, so the full conjunction is never built.
+
+template <class BDD>
+BDD Bdd_base<BDD>::bigAndExists(const std::vector<BDD>& args, const std::vector<int>& variables) {
+    std::set<int> quantify(variables.begin(), variables.end());
+    std::vector<std::vector<int>> schedule(args.size());
+    for (int i=args.size()-1; i>=0; i--) { // the last argument depending on x quantifies x
+        for (int x : args[i].Support()) {
+            if (quantify.erase(x) > 0)
+                schedule[i].push_back(x);
+        }
+    }
+    BDD bdd = BDD(true); // neutral element
+    for (size_t i=0; i<args.size(); i++) {
+        LOG(2,".");
+        bdd = bdd.AndAbstract(args[i], schedule[i]);
+        if (bdd == BDD(false)) break; // absorbing element
+    }
+    return bdd;
+}
+
+/* Serialization */
+
+// The format is: the number of nodes and of roots, the nodes (var, low, high)
+// in post-order, and the roots. A reference is 0 (false), 1 (true) or k+2
+// for the k-th node. All numbers are 32 bits, in host byte order.
+
+template <class BDD>
+void Bdd_base<BDD>::Write(std::ostream& out, const std::vector<BDD>& roots) {
+    std::unordered_map<size_t,uint32_t> index;  // Hash() -> reference
+    std::vector<uint32_t> nodes, refs;
+    auto lookup = [&index](const BDD& bdd, uint32_t& ref) { // false if not written yet
+        if (bdd.isConstant()) { ref = (bdd == BDD(true)); return true; }
+        auto it = index.find(bdd.Hash());
+        if (it == index.end()) return false;
+        ref = it->second;
+        return true;
+    };
+    for (const BDD& root : roots) {
+        std::vector<BDD> todo({root});
+        while (todo.size() > 0) {
+            const BDD bdd = todo.back();
+            uint32_t ref, lo, hi;
+            if (lookup(bdd, ref)) { todo.pop_back(); continue; }
+            const BDD low = bdd.Else(), high = bdd.Then();
+            const bool l = lookup(low, lo), h = lookup(high, hi);
+            if (l && h) {
+                nodes.insert(nodes.end(), {(uint32_t)bdd.TopVar(), lo, hi});
+                index[bdd.Hash()] = nodes.size()/3 + 1;
+                todo.pop_back();
+            } else {
+                if (!l) todo.push_back(low);
+                if (!h) todo.push_back(high);
+            }
+        }
+        uint32_t ref;
+        lookup(root, ref);
+        refs.push_back(ref);
+    }
+    const uint32_t counts[2] = {(uint32_t)(nodes.size()/3), (uint32_t)refs.size()};
+    out.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+    out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size()*sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(refs.data()), refs.size()*sizeof(uint32_t));
+}
+
+template <class BDD>
+bool Bdd_base<BDD>::Read(std::istream& in, std::vector<BDD>& roots) {
+    uint32_t counts[2];
+    if (!in.read(reinterpret_cast<char*>(counts), sizeof(counts))) return false;
+    std::vector<BDD> bdds({BDD(false), BDD(true)});
+    for (uint32_t k=0; k<counts[0]; k++) {
+        uint32_t node[3];
+        if (!in.read(reinterpret_cast<char*>(node), sizeof(node))) return false;
+        if (node[1] >= bdds.size() || node[2] >= bdds.size()) return false;
+        bdds.push_back(BDD((int)node[0]).Ite(bdds[node[2]], bdds[node[1]]));
+    }
+    roots.clear();
+    for (uint32_t k=0; k<counts[1]; k++) {
+        uint32_t ref;
+        if (!in.read(reinterpret_cast<char*>(&ref), sizeof(ref)) || ref >= bdds.size()) return false;
+        roots.push_back(bdds[ref]);
+    }
+    return true;
+}
+
+/* Alternative implementation: combine BDDs pairwise, etc. (map/reduce) */
+
+template <class BDD>
+BDD Bdd_base<BDD>::bigAnd_pairwise(const std::vector<BDD>& args) {
+    BDD bdd = BDD(true); // neutral element
+    if (args.size() == 0)
+        return bdd;
+    std::deque<BDD> todo(args.begin(), args.end());
+    while (todo.size() > 1) {
+        LOG(2,".");
+        BDD arg1 = todo.front(); todo.pop_front();
+        BDD arg2 = todo.front(); todo.pop_front();
+        arg1 *= arg2;
+        if (arg1 == BDD(false)) return arg1; // absorbing element
+        todo.push_back(arg1);
+    }
+    return todo[0];
+}
+
+template <class BDD>
+BDD Bdd_base<BDD>::bigOr_pairwise(const std::vector<BDD>& args) {
+    BDD bdd = BDD(false); // neutral element
+    if (args.size() == 0)
+        return bdd;
+    std::deque<BDD> todo(args.begin(), args.end());
+    while (todo.size() > 1) {
+        LOG(2,".");
+        BDD arg1 = todo.front(); todo.pop_front();
+        BDD arg2 = todo.front(); todo.pop_front();
+        arg1 += arg2;
+        if (arg1 == BDD(true)) return arg1; // absorbing element
+        todo.push_back(arg1);
+    }
+    return todo[0];
+}
+
+#endif // BDD_BASE_H
@@ -0,0 +1,503 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <iostream>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <string>
+#include <cassert>
+
+#include "bdd_builtin.hpp"
+#include "watchdog.hpp"
+#include "settings.hpp"
+
+/*** Node storage ***/
+
+// A node has a variable and two edges. The high edge is never complemented,
+// which makes the representation with complement edges canonical.
+
+struct Node {
+    uint32_t var;
+    uint32_t low;
+    uint32_t high;
+};
+
+constexpr uint32_t TRUE  = 0;
+constexpr uint32_t FALSE = 1;
+constexpr uint32_t LEAF = UINT32_MAX;       // variable of the terminal node
+constexpr uint32_t FREE = UINT32_MAX-1;     // variable of a node in the free list
+
+static std::vector<Node> nodes;             // node 0 is the terminal
+static std::vector<uint32_t> refs;          // external references per node
+static std::vector<uint32_t> freelist;      // nodes reclaimed by gc
+static size_t maxnodes;                     // at most 2^table nodes, or as the budget allows
+static size_t budget;                       // memory budget in bytes (0 = none)
+static size_t gcthreshold;                  // next gc when this many nodes are live
+
+// The unique table is open-addressed with linear probing (0 = empty slot).
+// It is kept at most half full, and rebuilt after gc.
+static std::vector<uint32_t> unique;
+static size_t uniquecount;
+
+// The computed table is direct-mapped: a new entry overwrites the old one.
+// It has unique.size() >> cacheshift entries, up to maxcache. The ratio is
+// adapted to the hit rate whenever the tables are rebuilt.
+struct CacheEntry {
+    uint32_t op, a, b, c;
+    uint32_t result;
+};
+enum Op : uint32_t {EMPTY, AND, XOR, ITE, RESTRICT, CONSTRAIN, EXISTS, ANDEXISTS};
+static std::vector<CacheEntry> cache;
+static size_t maxcache;
+static int cacheshift = 1;
+static size_t lookups = 0, hits = 0;        // since the last rebuild
+
+// bytes per node: the node, its references, free list and unique table slots
+constexpr size_t NODE_BYTES = sizeof(Node) + 2*sizeof(uint32_t) + 4*sizeof(uint32_t);
+
+static inline size_t hash(uint32_t a, uint32_t b, uint32_t c, uint32_t d=0) {
+    uint64_t h = a * 0x9E3779B97F4A7C15ULL;
+    h = (h ^ b) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ c) * 0x94D049BB133111EBULL;
+    h = (h ^ d) * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 31);
+}
+
+static inline uint32_t var(uint32_t e)  { return nodes[e>>1].var; }
+static inline uint32_t low(uint32_t e)  { return nodes[e>>1].low ^ (e&1); }
+static inline uint32_t high(uint32_t e) { return nodes[e>>1].high ^ (e&1); }
+
+static size_t liveNodes() { return nodes.size() - 1 - freelist.size(); }
+
+static void insertUnique(uint32_t index) {
+    const Node& n = nodes[index];
+    size_t mask = unique.size()-1;
+    size_t h = hash(n.var, n.low, n.high) & mask;
+    while (unique[h] != 0) h = (h+1) & mask;
+    unique[h] = index;
+    uniquecount++;
+}
+
+// Rebuild the unique table with the given size, for all nodes in use.
+// The computed table grows along with it, and is cleared: it doubles its
+// share on a hit rate above 1/2, and halves it below 1/8.
+static void rebuild(size_t size) {
+    unique.assign(size, 0);
+    uniquecount = 0;
+    for (size_t i=1; i<nodes.size(); i++)
+        if (nodes[i].var != FREE) insertUnique(i);
+    if (lookups >= cache.size()) { // enough samples
+        if (hits*2 > lookups && cacheshift > 0) cacheshift--;
+        else if (hits*8 < lookups && cacheshift < 3) cacheshift++;
+    }
+    lookups = hits = 0;
+    cache.assign(std::max((size_t)1, std::min(size >> cacheshift, maxcache)), CacheEntry({EMPTY,0,0,0,0}));
+}
+
+// A full table is only reported when gc doesn't help. Since gc cannot run
+// within an operation (its intermediate results are not referenced), mk
+// throws Full, and the operation is abandoned and done again after gc.
+struct Full { };
+
+[[noreturn]] static void full() {
+    if (budget > 0)
+        Watchdog::halt("BDD memory budget of " + std::to_string(budget >> 20) + " MB exhausted ("
+                       + std::to_string(maxnodes) + " nodes), try a larger -mem");
+    Watchdog::halt("built-in BDD table is full (" + std::to_string(maxnodes) + " nodes), try a larger -t");
+}
+
+// find or create the node (var, low, high), return its edge
+static uint32_t mk(uint32_t v, uint32_t l, uint32_t h) {
+    if (l == h) return l;
+    if (h & 1) return mk(v, l^1, h^1) ^ 1; // keep high edges regular
+    size_t mask = unique.size()-1;
+    size_t slot = hash(v, l, h) & mask;
+    while (unique[slot] != 0) {
+        const Node& n = nodes[unique[slot]];
+        if (n.var == v && n.low == l && n.high == h) return unique[slot] << 1;
+        slot = (slot+1) & mask;
+    }
+    uint32_t index;
+    if (freelist.size() > 0) {
+        index = freelist.back(); freelist.pop_back();
+        nodes[index] = Node({v, l, h});
+    } else {
+        if (nodes.size() >= maxnodes) throw Full();
+        index = nodes.size();
+        nodes.push_back(Node({v, l, h}));
+        refs.push_back(0);
+    }
+    unique[slot] = index;
+    if (++uniquecount * 2 > unique.size()) rebuild(unique.size() * 2);
+    return index << 1;
+}
+
+static inline bool cacheLookup(uint32_t op, uint32_t a, uint32_t b, uint32_t c, uint32_t& result) {
+    const CacheEntry& entry = cache[hash(op, a, b, c) & (cache.size()-1)];
+    lookups++;
+    if (entry.op == op && entry.a == a && entry.b == b && entry.c == c) {
+        result = entry.result;
+        hits++;
+        return true;
+    }
+    return false;
+}
+
+static inline void cacheStore(uint32_t op, uint32_t a, uint32_t b, uint32_t c, uint32_t result) {
+    cache[hash(op, a, b, c) & (cache.size()-1)] = CacheEntry({op, a, b, c, result});
+}
+
+/*** Garbage collection ***/
+
+// Mark all nodes reachable from external references, free the others.
+// This is only called between operations, when all intermediate
+// results are held by a Builtin_Bdd.
+
+static void mark(uint32_t index, std::vector<bool>& marked) {
+    while (index != 0 && !marked[index]) {
+        marked[index] = true;
+        mark(nodes[index].low >> 1, marked);
+        index = nodes[index].high >> 1;
+    }
+}
+
+void Builtin_mgr::gc() {
+    LOG(2, "[gc..");
+    std::vector<bool> marked(nodes.size(), false);
+    for (size_t i=1; i<nodes.size(); i++)
+        if (refs[i] > 0) mark(i, marked);
+    freelist.clear();
+    for (size_t i=nodes.size()-1; i>=1; i--) {
+        if (!marked[i]) {
+            nodes[i].var = FREE;
+            freelist.push_back(i);
+        }
+    }
+    rebuild(unique.size());
+    Watchdog::usage(liveNodes(), maxnodes);
+    LOG(2, liveNodes() << "]");
+}
+
+static void maybeGc() {
+    if (liveNodes() < gcthreshold) return;
+    Builtin_mgr::gc();
+    while (liveNodes() * 2 > gcthreshold && gcthreshold < maxnodes)
+        gcthreshold *= 2;
+}
+
+// run an operation on edges, once more after gc if the table was full
+template <class Operation>
+static uint32_t apply(Operation op) {
+    maybeGc();
+    try {
+        return op();
+    } catch (const Full&) {
+        LOG(2, "[full]");
+        Builtin_mgr::gc();
+    }
+    try {
+        return op();
+    } catch (const Full&) {
+        full();
+    }
+}
+
+// With a memory budget, 3/4 is for the nodes and 1/4 for the computed table
+Builtin_mgr::Builtin_mgr(int table, size_t memory) {
+    budget = memory;
+    if (budget > 0) {
+        maxnodes = std::min(budget / 4 * 3 / NODE_BYTES, (size_t)1 << 31);
+        maxcache = 1;
+        while (2 * maxcache * sizeof(CacheEntry) <= budget / 4) maxcache <<= 1;
+        LOG(2, "Opening built-in BDDs (" << (budget >> 20) << " MB: "
+            << maxnodes << " nodes, cache " << maxcache << ")" << std::endl);
+    } else {
+        LOG(2, "Opening built-in BDDs (table=2^" << table << ")" << std::endl);
+        maxnodes = 1ULL << std::min(table, 31);
+        maxcache = maxnodes;
+    }
+    cacheshift = 1;
+    lookups = hits = 0;
+    gcthreshold = std::min(maxnodes/2, (size_t)1 << 16);
+    nodes.assign(1, Node({LEAF, TRUE, TRUE}));
+    refs.assign(1, 0);
+    freelist.clear();
+    rebuild(1 << 12);
+}
+
+Builtin_mgr::~Builtin_mgr() {
+    nodes.clear(); refs.clear(); freelist.clear(); unique.clear(); cache.clear();
+    LOG(2, "Closed built-in BDDs" << std::endl);
+}
+
+/*** Recursive operations on edges ***/
+
+static uint32_t bdd_and(uint32_t a, uint32_t b) {
+    if (a == FALSE || b == FALSE || a == (b^1)) return FALSE;
+    if (a == TRUE || a == b) return b;
+    if (b == TRUE) return a;
+    if (a > b) std::swap(a, b);
+    uint32_t result;
+    if (cacheLookup(AND, a, b, 0, result)) return result;
+    uint32_t v = std::min(var(a), var(b));
+    uint32_t a0 = (var(a)==v ? low(a) : a),  a1 = (var(a)==v ? high(a) : a);
+    uint32_t b0 = (var(b)==v ? low(b) : b),  b1 = (var(b)==v ? high(b) : b);
+    uint32_t l = bdd_and(a0, b0);
+    uint32_t h = bdd_and(a1, b1);
+    result = mk(v, l, h);
+    cacheStore(AND, a, b, 0, result);
+    return result;
+}
+
+static inline uint32_t bdd_or(uint32_t a, uint32_t b) {
+    return bdd_and(a^1, b^1) ^ 1;
+}
+
+// complement bits are taken out, since xor(!a,b) = !xor(a,b)
+static uint32_t bdd_xor(uint32_t a, uint32_t b) {
+    uint32_t neg = (a^b) & 1;
+    a &= ~1u; b &= ~1u;
+    if (a == b) return FALSE ^ neg;
+    if (a == TRUE) return b ^ 1 ^ neg;
+    if (b == TRUE) return a ^ 1 ^ neg;
+    if (a > b) std::swap(a, b);
+    uint32_t result;
+    if (cacheLookup(XOR, a, b, 0, result)) return result ^ neg;
+    uint32_t v = std::min(var(a), var(b));
+    uint32_t a0 = (var(a)==v ? low(a) : a),  a1 = (var(a)==v ? high(a) : a);
+    uint32_t b0 = (var(b)==v ? low(b) : b),  b1 = (var(b)==v ? high(b) : b);
+    uint32_t l = bdd_xor(a0, b0);
+    uint32_t h = bdd_xor(a1, b1);
+    result = mk(v, l, h);
+    cacheStore(XOR, a, b, 0, result);
+    return result ^ neg;
+}
+
+// the condition f and the then-branch g are kept regular
+static uint32_t bdd_ite(uint32_t f, uint32_t g, uint32_t h) {
+    if (f == TRUE) return g;
+    if (f == FALSE) return h;
+    if (g == f) g = TRUE; else if (g == (f^1)) g = FALSE;
+    if (h == f) h = FALSE; else if (h == (f^1)) h = TRUE;
+    if (g == h) return g;
+    if (g == TRUE) return bdd_or(f, h);
+    if (g == FALSE) return bdd_and(f^1, h);
+    if (h == FALSE) return bdd_and(f, g);
+    if (h == TRUE) return bdd_or(f^1, g);
+    if (f & 1) { f ^= 1; std::swap(g, h); }
+    uint32_t neg = g & 1;
+    g ^= neg; h ^= neg;
+    uint32_t result;
+    if (cacheLookup(ITE, f, g, h, result)) return result ^ neg;
+    uint32_t v = std::min(var(f), std::min(var(g), var(h)));
+    uint32_t f0 = (var(f)==v ? low(f) : f),  f1 = (var(f)==v ? high(f) : f);
+    uint32_t g0 = (var(g)==v ? low(g) : g),  g1 = (var(g)==v ? high(g) : g);
+    uint32_t h0 = (var(h)==v ? low(h) : h),  h1 = (var(h)==v ? high(h) : h);
+    uint32_t l = bdd_ite(f0, g0, h0);
+    uint32_t r = bdd_ite(f1, g1, h1);
+    result = mk(v, l, r);
+    cacheStore(ITE, f, g, h, result);
+    return result ^ neg;
+}
+
+// Generalized cofactors: the result agrees with f where c holds. Where c is
+// false, the other branch of c is followed. Restrict also quantifies the
+// top variables of c that f does not depend on, so it never adds variables.
+// Since op(!f,c) = !op(f,c), the complement bit of f is taken out.
+static uint32_t bdd_cofactor(Op op, uint32_t f, uint32_t c) {
+    if (c <= 1 || f <= 1) return f; // c = false: nothing to care about
+    if (f == c) return TRUE;
+    if (f == (c^1)) return FALSE;
+    uint32_t neg = f & 1;
+    f ^= neg;
+    uint32_t result;
+    if (cacheLookup(op, f, c, 0, result)) return result ^ neg;
+    uint32_t v = std::min(var(f), var(c));
+    uint32_t f0 = (var(f)==v ? low(f) : f),  f1 = (var(f)==v ? high(f) : f);
+    uint32_t c0 = (var(c)==v ? low(c) : c),  c1 = (var(c)==v ? high(c) : c);
+    if (op == RESTRICT && var(f) != v)
+        result = bdd_cofactor(op, f, bdd_or(c0, c1));
+    else if (c0 == FALSE)
+        result = bdd_cofactor(op, f1, c1);
+    else if (c1 == FALSE)
+        result = bdd_cofactor(op, f0, c0);
+    else {
+        uint32_t l = bdd_cofactor(op, f0, c0);
+        uint32_t h = bdd_cofactor(op, f1, c1);
+        result = mk(v, l, h);
+    }
+    cacheStore(op, f, c, 0, result);
+    return result ^ neg;
+}
+
+// cube is a conjunction of positive variables
+static uint32_t bdd_exists(uint32_t a, uint32_t cube) {
+    if (a <= 1) return a;
+    while (cube != TRUE && var(cube) < var(a)) cube = high(cube);
+    if (cube == TRUE) return a;
+    uint32_t result;
+    if (cacheLookup(EXISTS, a, cube, 0, result)) return result;
+    uint32_t v = var(a);
+    if (var(cube) == v) {
+        uint32_t l = bdd_exists(low(a), high(cube));
+        result = (l == TRUE ? TRUE : bdd_or(l, bdd_exists(high(a), high(cube))));
+    } else {
+        uint32_t l = bdd_exists(low(a), cube);
+        uint32_t h = bdd_exists(high(a), cube);
+        result = mk(v, l, h);
+    }
+    cacheStore(EXISTS, a, cube, 0, result);
+    return result;
+}
+
+static uint32_t bdd_and_exists(uint32_t a, uint32_t b, uint32_t cube) {
+    if (a == FALSE || b == FALSE || a == (b^1)) return FALSE;
+    if (a == TRUE) return bdd_exists(b, cube);
+    if (b == TRUE || a == b) return bdd_exists(a, cube);
+    if (a > b) std::swap(a, b);
+    uint32_t v = std::min(var(a), var(b));
+    while (cube != TRUE && var(cube) < v) cube = high(cube);
+    if (cube == TRUE) return bdd_and(a, b);
+    uint32_t result;
+    if (cacheLookup(ANDEXISTS, a, b, cube, result)) return result;
+    uint32_t a0 = (var(a)==v ? low(a) : a),  a1 = (var(a)==v ? high(a) : a);
+    uint32_t b0 = (var(b)==v ? low(b) : b),  b1 = (var(b)==v ? high(b) : b);
+    if (var(cube) == v) {
+        uint32_t l = bdd_and_exists(a0, b0, high(cube));
+        result = (l == TRUE ? TRUE : bdd_or(l, bdd_and_exists(a1, b1, high(cube))));
+    } else {
+        uint32_t l = bdd_and_exists(a0, b0, cube);
+        uint32_t h = bdd_and_exists(a1, b1, cube);
+        result = mk(v, l, h);
+    }
+    cacheStore(ANDEXISTS, a, b, cube, result);
+    return result;
+}
+
+static uint32_t makeCube(const std::vector<int>& variables) {
+    std::vector<int> vars(variables);
+    std::sort(vars.begin(), vars.end());
+    uint32_t cube = TRUE;
+    for (auto it=vars.rbegin(); it!=vars.rend(); it++)
+        cube = mk(*it, FALSE, cube);
+    return cube;
+}
+
+/*** Builtin_Bdd ***/
+
+void Builtin_Bdd::ref(uint32_t e) {
+    if ((e>>1) != 0) refs[e>>1]++;
+}
+
+void Builtin_Bdd::deref(uint32_t e) {
+    if ((e>>1) != 0 && (e>>1) < refs.size()) refs[e>>1]--;
+}
+
+Builtin_Bdd::Builtin_Bdd(int i) {
+    edge = apply([i]() { return mk(i, FALSE, TRUE); });
+    ref(edge);
+}
+
+Builtin_Bdd& Builtin_Bdd::operator+=(const Builtin_Bdd& other) {
+    *this = Builtin_Bdd(apply([&]() { return bdd_or(edge, other.edge); }), true);
+    peak();
+    return *this;
+}
+
+Builtin_Bdd& Builtin_Bdd::operator*=(const Builtin_Bdd& other) {
+    *this = Builtin_Bdd(apply([&]() { return bdd_and(edge, other.edge); }), true);
+    peak();
+    return *this;
+}
+
+Builtin_Bdd& Builtin_Bdd::operator^=(const Builtin_Bdd& other) {
+    *this = Builtin_Bdd(apply([&]() { return bdd_xor(edge, other.edge); }), true);
+    peak();
+    return *this;
+}
+
+Builtin_Bdd Builtin_Bdd::Ite(const Builtin_Bdd& t, const Builtin_Bdd& e) const {
+    Builtin_Bdd result(apply([&]() { return bdd_ite(edge, t.edge, e.edge); }), true);
+    result.peak();
+    return result;
+}
+
+Builtin_Bdd Builtin_Bdd::Restrict(const Builtin_Bdd& care) const {
+    return Builtin_Bdd(apply([&]() { return bdd_cofactor(RESTRICT, edge, care.edge); }), true);
+}
+
+Builtin_Bdd Builtin_Bdd::Constrain(const Builtin_Bdd& care) const {
+    return Builtin_Bdd(apply([&]() { return bdd_cofactor(CONSTRAIN, edge, care.edge); }), true);
+}
+
+// forall x A = !exists x !A
+Builtin_Bdd Builtin_Bdd::Quantify(const std::vector<int>& variables, bool exists) const {
+    if (exists)
+        return Builtin_Bdd(apply([&]() { return bdd_exists(edge, makeCube(variables)); }), true);
+    else
+        return Builtin_Bdd(apply([&]() { return bdd_exists(edge^1, makeCube(variables)) ^ 1; }), true);
+}
+
+// exists variables (this /\ other), without building the conjunction
+Builtin_Bdd Builtin_Bdd::AndAbstract(const Builtin_Bdd& other, const std::vector<int>& variables) const {
+    Builtin_Bdd result(apply([&]() { return bdd_and_exists(edge, other.edge, makeCube(variables)); }), true);
+    result.peak();
+    return result;
+}
+
+// the variables this BDD depends on, in increasing order
+std::vector<int> Builtin_Bdd::Support() const {
+    std::set<int> vars;
+    std::set<uint32_t> seen;
+    std::vector<uint32_t> todo({edge>>1});
+    while (todo.size() != 0) {
+        uint32_t i = todo.back(); todo.pop_back();
+        if (i == 0 || !seen.insert(i).second) continue;
+        vars.insert(nodes[i].var);
+        todo.push_back(nodes[i].low >> 1);
+        todo.push_back(nodes[i].high >> 1);
+    }
+    return std::vector<int>(vars.begin(), vars.end());
+}
+
+// number of nodes, excluding the terminal (as Sylvan)
+size_t Builtin_Bdd::NodeCount() const {
+    std::set<uint32_t> seen;
+    std::vector<uint32_t> todo({edge>>1});
+    while (todo.size() != 0) {
+        uint32_t i = todo.back(); todo.pop_back();
+        if (i == 0 || !seen.insert(i).second) continue;
+        todo.push_back(nodes[i].low >> 1);
+        todo.push_back(nodes[i].high >> 1);
+    }
+    return seen.size();
+}
+
+uint32_t Builtin_Bdd::TopVar() const    { return var(edge); }
+Builtin_Bdd Builtin_Bdd::Then() const   { return Builtin_Bdd(high(edge), true); }
+Builtin_Bdd Builtin_Bdd::Else() const   { return Builtin_Bdd(low(edge), true); }
+
+// Same choice as Sylvan's PickOneCube: walking the variables in increasing
+// order, follow the low edge unless it is false.
+// Returns the values in the order of the given variables.
+std::vector<bool> Builtin_Bdd::PickOneCube(const std::vector<int>& vars) const {
+    if (edge == FALSE) return std::vector<bool>();
+    std::vector<int> index;
+    for (size_t i=0; i<vars.size(); i++)
+        index.push_back(i);
+    const auto cmp = [&vars](int a, int b) { return vars[a] < vars[b]; };
+    std::sort(index.begin(), index.end(), cmp);
+
+    std::vector<bool> val(vars.size(), false);
+    uint32_t e = edge;
+    for (int i : index) {
+        if (e <= 1 || var(e) != (uint32_t)vars[i]) continue; // pick false
+        if (low(e) == FALSE) {
+            val[i] = true;
+            e = high(e);
+        } else
+            e = low(e);
+    }
+    return val;
+}
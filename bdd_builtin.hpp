@@ -0,0 +1,90 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef BDD_BUILTIN_H
+#define BDD_BUILTIN_H
+
+#include <vector>
+#include <cstdint>
+
+#include "bdd_base.hpp"
+#include "settings.hpp"
+
+class Builtin_mgr {
+
+// A small single-threaded BDD package, which doesn't need Lace.
+// There should be at most one instance of a Builtin_mgr alive at any moment.
+// This is currently not enforced.
+
+public:
+    Builtin_mgr(int table=30, size_t memory=0); // at most 2^table nodes, or within memory bytes
+    ~Builtin_mgr();
+
+    static void gc(); // collect unreferenced BDD nodes (mark and sweep)
+};
+
+
+class Builtin_Bdd : public Bdd_base<Builtin_Bdd> {
+
+// Builtin_Bdd can only be used when there is a Builtin_mgr active.
+// This is currently not enforced.
+// A BDD is an edge: (node index << 1 | complement bit). Node 0 is the
+// terminal, so edge 0 is true and edge 1 is false. Each Builtin_Bdd
+// is an external reference, which protects its nodes during gc.
+
+public:
+
+/* public constructors */
+
+    // create constant BDD true/false
+    Builtin_Bdd(bool b) : edge(b ? 0 : 1) { }
+
+    // create BDD variable(i)
+    Builtin_Bdd(int i);
+
+    Builtin_Bdd(const Builtin_Bdd& other) : edge(other.edge) { ref(edge); }
+    Builtin_Bdd& operator=(const Builtin_Bdd& other) {
+        ref(other.edge); deref(edge); edge = other.edge; return *this;
+    }
+    ~Builtin_Bdd() { deref(edge); }
+
+/* BDD operations */
+
+    bool isConstant() const                         { return edge <= 1; }
+    bool operator==(const Builtin_Bdd& other) const { return edge == other.edge; }
+    Builtin_Bdd& operator+=(const Builtin_Bdd& other);
+    Builtin_Bdd& operator*=(const Builtin_Bdd& other);
+    Builtin_Bdd& operator^=(const Builtin_Bdd& other);
+    Builtin_Bdd  operator!() const                  { return Builtin_Bdd(edge ^ 1, true); }
+    Builtin_Bdd  Ite(const Builtin_Bdd& t, const Builtin_Bdd& e) const;
+    Builtin_Bdd  Restrict(const Builtin_Bdd& care) const;
+    Builtin_Bdd  Constrain(const Builtin_Bdd& care) const;
+
+    Builtin_Bdd Quantify(const std::vector<int>& variables, bool exists) const;
+    Builtin_Bdd AndAbstract(const Builtin_Bdd& other, const std::vector<int>& variables) const;
+    std::vector<int> Support() const;
+    std::vector<bool> PickOneCube(const std::vector<int>& variables) const;
+
+/* statistics */
+
+    size_t NodeCount() const;
+    size_t Hash() const                             { return edge; }
+
+/* structure (see Bdd_base::Write) */
+
+    uint32_t TopVar() const;
+    Builtin_Bdd Then() const;
+    Builtin_Bdd Else() const;
+
+    static void gc()                                { Builtin_mgr::gc(); }
+
+private:
+
+    uint32_t edge;
+    Builtin_Bdd(uint32_t e, bool) : edge(e) { ref(edge); }
+    static void ref(uint32_t e);
+    static void deref(uint32_t e);
+
+};
+
+#endif // BDD_BUILTIN_H
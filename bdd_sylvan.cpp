@@ -2,63 +2,140 @@
 // Aarhus University
 
 #include <vector>
-#include <deque>
+#include <map>
 #include <algorithm>
+#include <string>
 
 #include "bdd_sylvan.hpp"
+#include "watchdog.hpp"
 #include "settings.hpp"
 
 using namespace sylvan;
 
+constexpr size_t NODE_BYTES = 24;  // per node in the unique table
+constexpr size_t CACHE_BYTES = 36; // per entry in the operation cache
+
+static size_t budget;       // memory budget in bytes (0 = none)
+static size_t maxnodes;
+
 VOID_TASK_0(gc_start) { LOG(2,"[gc.."); }
-VOID_TASK_0(gc_done) { LOG(2,"]"); }
 
-// start Sylvan, with number of workers, and unique table size 2^size
-Sylvan_mgr::Sylvan_mgr(int workers, int size) {
-    LOG(2, "Opening Sylvan BDDs ("
-        << workers << " workers, table=2^" << size << ")" << std::endl);
+// Sylvan doubles its tables during gc, up to maxnodes. When a table of that
+// size is still nearly full after gc, the solver stops at the next check
+// point, rather than crashing on a full table later. This cannot help an
+// operation that fills the table by itself: Sylvan then exits (after gc),
+// and counting the table before each operation would be too expensive.
+VOID_TASK_0(gc_done) {
+    LOG(2,"]");
+    size_t filled, total;
+    sylvan_table_usage(&filled, &total);
+    Watchdog::usage(filled, total);
+    if (total >= maxnodes && filled*10 > total*9) {
+        if (budget > 0)
+            Watchdog::alert("BDD memory budget of " + std::to_string(budget >> 20) + " MB exhausted ("
+                            + std::to_string(filled) + " of " + std::to_string(total) + " nodes), try a larger -mem");
+        else
+            Watchdog::alert("Sylvan BDD table is full (" + std::to_string(filled) + " of "
+                            + std::to_string(total) + " nodes), try a larger -t");
+    }
+}
+
+// start Sylvan, with number of workers, and unique table size 2^size.
+// With a memory budget, the largest table gets 3/4 of it and the cache the
+// rest (at most one entry per node), and the initial sizes follow the
+// number of gates of the circuit, so small instances start fast.
+Sylvan_mgr::Sylvan_mgr(int workers, int size, size_t memory, size_t gates) {
+    budget = memory;
+    long long initnodes, maxcache, initcache;
+    if (budget > 0) {
+        maxnodes = (size_t)1 << 42;
+        while (maxnodes * NODE_BYTES > budget / 4 * 3) maxnodes >>= 1;
+        maxcache = maxnodes;
+        while (maxcache * CACHE_BYTES > budget - maxnodes * NODE_BYTES) maxcache >>= 1;
+        initnodes = 1 << 16;
+        while ((size_t)initnodes < (gates << 8) && (size_t)initnodes < maxnodes) initnodes <<= 1;
+        initnodes = std::min(initnodes, (long long)maxnodes);
+        initcache = std::min(initnodes >> 2, maxcache);
+        LOG(2, "Opening Sylvan BDDs (" << workers << " workers, " << (budget >> 20) << " MB: table=2^"
+            << __builtin_ctzll(initnodes) << "..2^" << __builtin_ctzll(maxnodes)
+            << ", cache=2^" << __builtin_ctzll(initcache) << "..2^" << __builtin_ctzll(maxcache) << ")" << std::endl);
+    } else {
+        LOG(2, "Opening Sylvan BDDs ("
+            << workers << " workers, table=2^" << size << ")" << std::endl);
+        maxnodes = 1L << size;
+        initnodes = maxnodes >> 6;
+        maxcache  = maxnodes >> 2;
+        initcache = maxcache >> 4;
+    }
     lace_start(workers, 0); // deque_size 0
-    long long maxnodes = 1L << size; 
-    long long initnodes = maxnodes >> 6;
-    long long maxcache  = maxnodes >> 2;
-    long long initcache = maxcache >> 4;
     sylvan_set_sizes(initnodes, maxnodes, initcache, maxcache);
     sylvan_init_package();
     sylvan_init_bdd();
-    if (VERBOSE>=2) {
-        sylvan_gc_hook_pregc(TASK(gc_start)); // message for garbage collection
-        sylvan_gc_hook_postgc(TASK(gc_done)); // message for garbage collection
-    }
+    sylvan_gc_hook_pregc(TASK(gc_start)); // message for garbage collection
+    sylvan_gc_hook_postgc(TASK(gc_done)); // message, and check for a full table
 }
 
+constexpr size_t MAXCUBES = 1024; // see cachedCube
+static std::map<std::vector<int>, Bdd> cubes;
+
 Sylvan_mgr::~Sylvan_mgr() {
+    cubes.clear(); // cached BDDs must be released before Sylvan quits
     sylvan_stats_report(stdout); // requires SYLVAN_STATS=on during Sylvan compilation
     sylvan_quit();
     lace_stop();
     LOG(2, "Closed Sylvan BDDs" << std::endl);
 }
 
+void Sylvan_mgr::gc() {
+    cubes.clear(); // don't keep the cubes of earlier phases and circuits alive
+    sylvan_gc();
+    if (VERBOSE>=2) {
+        size_t filled, total;
+        sylvan_table_usage(&filled, &total);
+        LOG(2, "[table " << filled << "/" << total << "]" << std::endl);
+    }
+}
+
 inline Bdd makeCube(const std::vector<int>& variables) {
     Bdd cube = sylvan_true;
     for (int var : variables) cube *= Bdd::bddVar(var);
     return cube;
 }
 
+// Cubes for the blocks and quantifier gates are cached, since the same block
+// is quantified many times. The cache is emptied at each explicit gc (between
+// phases and circuits), when it holds MAXCUBES cubes, and before Sylvan closes.
 
-Sylvan_Bdd Sylvan_Bdd::UnivAbstract(const std::vector<int>& variables)  const {
+Bdd cachedCube(const std::vector<int>& variables) {
+    auto it = cubes.find(variables);
+    if (it != cubes.end()) return it->second;
+    if (cubes.size() >= MAXCUBES) cubes.clear();
     Bdd cube = makeCube(variables);
-    Sylvan_Bdd result(bdd.UnivAbstract(cube));
-    result.peak();
-    return result;
+    cubes.emplace(variables, cube);
+    return cube;
 }
 
-Sylvan_Bdd Sylvan_Bdd::ExistAbstract(const std::vector<int>& variables) const{
+Sylvan_Bdd Sylvan_Bdd::Quantify(const std::vector<int>& variables, bool exists) const {
+    Bdd cube = cachedCube(variables);
+    return Sylvan_Bdd(exists ? bdd.ExistAbstract(cube) : bdd.UnivAbstract(cube));
+}
+
+// exists variables (this /\ other), without building the conjunction
+Sylvan_Bdd Sylvan_Bdd::AndAbstract(const Sylvan_Bdd& other, const std::vector<int>& variables) const {
     Bdd cube = makeCube(variables);
-    Sylvan_Bdd result(bdd.ExistAbstract(cube));
+    Sylvan_Bdd result(bdd.AndAbstract(other.bdd, cube));
     result.peak();
     return result;
 }
 
+// the variables this BDD depends on, in increasing order
+std::vector<int> Sylvan_Bdd::Support() const {
+    std::vector<int> vars;
+    for (Bdd cube = bdd.Support(); !cube.isConstant(); cube = cube.Then())
+        vars.push_back(cube.TopVar());
+    return vars;
+}
+
 std::vector<bool> Sylvan_Bdd::PickOneCube(const std::vector<int>& vars) const {
 
     // Sylvan's PickOneCube returns a SORTED valuation
@@ -90,78 +167,3 @@ std::vector<bool> Sylvan_Bdd::PickOneCube(const std::vector<int>& vars) const {
 
     return val2;
 }
-
-// TODO: could use parallel reduce (TASKS)
-// TODO: maybe use vector<std::reference_wrapper<Sylvan_Bdd>>? (Looks ugly)
-
-
-Sylvan_Bdd bigAnd_left2right(const std::vector<Sylvan_Bdd>& args);
-Sylvan_Bdd bigOr_left2right(const std::vector<Sylvan_Bdd>& args);
-Sylvan_Bdd bigAnd_pairwise(const std::vector<Sylvan_Bdd>& args);
-Sylvan_Bdd bigOr_pairwise(const std::vector<Sylvan_Bdd>& args);
-
-
-Sylvan_Bdd Sylvan_Bdd::bigAnd(const std::vector<Sylvan_Bdd>& args) {
-    if (ITERATE == 0) return bigAnd_left2right(args);
-    if (ITERATE == 1) return bigAnd_pairwise(args);
-    std::cerr << "Internal error: ITERATE value" << ITERATE << std::endl;
-    exit(-1);
-}
-
-Sylvan_Bdd Sylvan_Bdd::bigOr(const std::vector<Sylvan_Bdd>& args) {
-    if (ITERATE == 0) return bigOr_left2right(args);
-    if (ITERATE == 1) return bigOr_pairwise(args);
-    std::cerr << "Internal error: ITERATE value" << ITERATE << std::endl;
-    exit(-1);
-}
-
-Sylvan_Bdd bigAnd_left2right(const std::vector<Sylvan_Bdd>& args) {
-    Sylvan_Bdd bdd = Sylvan_Bdd(true); // neutral element
-    for (Sylvan_Bdd arg: args) {
-        LOG(2,".");
-        bdd *= arg;
-    }
-    return bdd;
-}
-
-Sylvan_Bdd bigOr_left2right(const std::vector<Sylvan_Bdd>& args) {
-    Sylvan_Bdd bdd = Sylvan_Bdd(false); // neutral element
-    for (Sylvan_Bdd arg: args) {
-        LOG(2,".");
-        bdd += arg;
-    }
-    return bdd;
-}
-
-
-/* Alternative implementation: combine BDDs pairwise, etc. (map/reduce) */
-
-Sylvan_Bdd bigAnd_pairwise(const std::vector<Sylvan_Bdd>& args) {
-    Sylvan_Bdd bdd = Sylvan_Bdd(true); // neutral element
-    if (args.size() == 0)
-        return bdd;
-    std::deque<Sylvan_Bdd> todo(args.begin(), args.end());
-    while (todo.size() > 1) {
-        LOG(2,".");
-        Sylvan_Bdd arg1 = todo.front(); todo.pop_front();
-        Sylvan_Bdd arg2 = todo.front(); todo.pop_front();
-        arg1 *= arg2;
-        todo.push_back(arg1);
-    }
-    return todo[0];
-}
-
-Sylvan_Bdd bigOr_pairwise(const std::vector<Sylvan_Bdd>& args) {
-    Sylvan_Bdd bdd = Sylvan_Bdd(false); // neutral element
-    if (args.size() == 0)
-        return bdd;
-    std::deque<Sylvan_Bdd> todo(args.begin(), args.end());
-    while (todo.size() > 1) {
-        LOG(2,".");
-        Sylvan_Bdd arg1 = todo.front(); todo.pop_front();
-        Sylvan_Bdd arg2 = todo.front(); todo.pop_front();
-        arg1 += arg2;
-        todo.push_back(arg1);
-    }
-    return todo[0];
-}
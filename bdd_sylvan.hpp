@@ -7,6 +7,7 @@
 #include <sylvan.h>
 #include <sylvan_obj.hpp>
 
+#include "bdd_base.hpp"
 #include "settings.hpp"
 
 class Sylvan_mgr {
@@ -15,12 +16,14 @@ class Sylvan_mgr {
 // This is currently not enforced.
 
 public:
-    Sylvan_mgr(int workers=0, int table=30);
+    Sylvan_mgr(int workers=0, int table=30, size_t memory=0, size_t gates=0); // table 2^n, or within memory bytes
     ~Sylvan_mgr();
+
+    static void gc(); // collect unreferenced BDD nodes, e.g. between phases
 };
 
 
-class Sylvan_Bdd {
+class Sylvan_Bdd : public Bdd_base<Sylvan_Bdd> {
 
 // Sylvan_Bdd can only be used when there is a Sylvan_mgr active.
 // This is currently not enforced.
@@ -41,33 +44,31 @@ public:
     bool operator==(const Sylvan_Bdd& other) const  { return bdd == other.bdd; }
     Sylvan_Bdd& operator+=(const Sylvan_Bdd& other) { bdd += other.bdd; peak(); return *this; }
     Sylvan_Bdd& operator*=(const Sylvan_Bdd& other) { bdd *= other.bdd; peak(); return *this; }
+    Sylvan_Bdd& operator^=(const Sylvan_Bdd& other) { bdd ^= other.bdd; peak(); return *this; }
     Sylvan_Bdd  operator!() const                   { return Sylvan_Bdd(!bdd); }
+    Sylvan_Bdd  Ite(const Sylvan_Bdd& t, const Sylvan_Bdd& e) const { return Sylvan_Bdd(bdd.Ite(t.bdd, e.bdd)).peak(); }
+    Sylvan_Bdd  Restrict(const Sylvan_Bdd& care) const  { return Sylvan_Bdd(bdd.Restrict(care.bdd)); }
+    Sylvan_Bdd  Constrain(const Sylvan_Bdd& care) const { return Sylvan_Bdd(bdd.Constrain(care.bdd)); }
 
 /* sylvan functions with convenient API */
 
-    Sylvan_Bdd UnivAbstract(const std::vector<int>& variables) const;
-    Sylvan_Bdd ExistAbstract(const std::vector<int>& variables) const;
+    Sylvan_Bdd Quantify(const std::vector<int>& variables, bool exists) const;
+    Sylvan_Bdd AndAbstract(const Sylvan_Bdd& other, const std::vector<int>& variables) const;
+    std::vector<int> Support() const;
     std::vector<bool> PickOneCube(const std::vector<int>& variables) const;
 
-/* folding operations */
-
-    static Sylvan_Bdd bigAnd(const std::vector<Sylvan_Bdd>&);
-    static Sylvan_Bdd bigOr(const std::vector<Sylvan_Bdd>&);
-
 /* statistics */
 
     size_t NodeCount() const                        { return bdd.NodeCount(); };
+    size_t Hash() const                             { return bdd.GetBDD(); }
+
+/* structure (see Bdd_base::Write) */
+
+    uint32_t TopVar() const                         { return bdd.TopVar(); }
+    Sylvan_Bdd Then() const                         { return Sylvan_Bdd(bdd.Then()); }
+    Sylvan_Bdd Else() const                         { return Sylvan_Bdd(bdd.Else()); }
 
-    const Sylvan_Bdd& peak() {
-        if (STATISTICS) { 
-            size_t count = NodeCount();
-            if (count > PEAK) {
-                PEAK = count;
-                LOG(1, "[peak " << PEAK << "]");
-            }
-        }
-        return *this;
-    }
+    static void gc()                                { Sylvan_mgr::gc(); }
 
 private:
 
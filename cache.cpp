@@ -0,0 +1,122 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "cache.hpp"
+#include "settings.hpp"
+
+using std::endl;
+
+typedef pair<uint64_t,uint64_t> Hash; // two independent 64-bit lanes
+
+static uint64_t mix(uint64_t h, uint64_t x) { // splitmix64 finalizer on h ^ x
+    h ^= x + 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+static Hash mix(Hash h, uint64_t x) {
+    return {mix(h.first, x), mix(h.second, ~x)};
+}
+
+static Hash mix(Hash h, Hash x) {
+    return {mix(h.first, x.first), mix(h.second, x.second)};
+}
+
+// Bottom-up over the cone of the output: a variable hashes its number, a
+// gate its connective, its quantified variables and the hashes of its
+// (signed) inputs, which are sorted except for ite.
+std::string Cache::key(const Circuit& c) {
+    const int first = c.maxVar();
+    const Hash seed({0x51AB0CACE0000001ULL, 0x51AB0CACE0000002ULL});
+    vector<Hash> hashes(c.maxGate());
+    vector<bool> cone(c.maxGate(), false);
+    cone[abs(c.getOutput())] = true;
+    for (int i=c.maxGate()-1; i>=first; i--)
+        if (cone[i])
+            for (int arg : c.getGate(i).inputs) cone[abs(arg)] = true;
+    const auto signedHash = [&hashes](int lit) { return lit > 0 ? hashes[lit] : mix(hashes[-lit], 1); };
+
+    for (int x=1; x<first; x++)
+        hashes[x] = mix(seed, x);
+    for (int i=first; i<c.maxGate(); i++) {
+        if (!cone[i]) continue;
+        const Gate& g = c.getGate(i);
+        Hash h = mix(mix(seed, 2), g.output);
+        vector<int> quants(g.quants);
+        std::sort(quants.begin(), quants.end());
+        for (int x : quants) h = mix(h, x);
+        h = mix(h, quants.size());
+        vector<Hash> args;
+        for (int arg : g.inputs) args.push_back(signedHash(arg));
+        if (g.output != Ite) std::sort(args.begin(), args.end());
+        for (const Hash& arg : args) h = mix(h, arg);
+        hashes[i] = mix(h, args.size());
+    }
+
+    Hash h = mix(mix(seed, 3), signedHash(c.getOutput()));
+    for (int i=0; i<c.maxBlock(); i++) {
+        vector<int> xs(c.getBlock(i).variables);
+        std::sort(xs.begin(), xs.end());
+        h = mix(h, c.getBlock(i).quantifier);
+        for (int x : xs) h = mix(h, x);
+        h = mix(h, xs.size());
+    }
+    std::ostringstream text;
+    text << std::hex << std::setfill('0') << std::setw(16) << h.first << std::setw(16) << h.second;
+    return text.str();
+}
+
+// An entry is "TRUE" or "FALSE", optionally followed by a line
+// "example <n> <var> <value> ...", with an empty example if there is none
+bool Cache::lookup(const std::string& key, bool example, bool& verdict, Valuation& valuation) {
+    std::ifstream entry(CACHE + "/" + key);
+    std::string word;
+    if (!(entry >> word) || (word != "TRUE" && word != "FALSE")) {
+        LOG(2, "Cache miss: " << key << endl);
+        return false;
+    }
+    verdict = (word == "TRUE");
+    valuation.clear();
+    size_t size;
+    if (entry >> word >> size && word == "example") {
+        for (size_t k=0; k<size; k++) {
+            int x, value;
+            if (!(entry >> x >> value)) return false;
+            valuation.push_back({x, value == 1});
+        }
+    } else if (example) {
+        LOG(2, "Cache entry without example: " << key << endl);
+        return false;
+    }
+    LOG(1, "Cache hit: " << key << endl);
+    return true;
+}
+
+void Cache::store(const std::string& key, bool example, bool verdict, const Valuation& valuation) {
+    mkdir(CACHE.c_str(), 0777); // if it doesn't exist yet
+    const std::string name = CACHE + "/" + key;
+    const std::string temp = name + "." + std::to_string(getpid()) + ".tmp";
+    std::ofstream entry(temp);
+    entry << (verdict ? "TRUE" : "FALSE") << endl;
+    if (example) {
+        entry << "example " << valuation.size();
+        for (auto [x, value] : valuation) entry << " " << x << " " << value;
+        entry << endl;
+    }
+    entry.close();
+    if (entry.fail() || rename(temp.c_str(), name.c_str()) != 0) {
+        LOG(1, "Warning: could not store the result in cache \"" << CACHE << "\"" << endl);
+        remove(temp.c_str());
+    } else
+        LOG(2, "Cached the result: " << key << endl);
+}
@@ -0,0 +1,28 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <string>
+#include "circuit.hpp"
+
+// A persistent cache of results (-cache=dir), shared by many processes.
+// The key is a structural hash of the transformed circuit: it ignores the
+// names, the numbering of the gates, the order of the inputs of and/or/xor,
+// and the gates outside the cone of the output. The variables do count by
+// their number, which after reordering (-r) follows the structure as well.
+// An entry is a file named by the key, holding the verdict and possibly an
+// example. It is written to a temporary file first, which is then renamed,
+// so readers never see a partial entry.
+
+class Cache {
+    public:
+        static std::string key(const Circuit& c); // 128 bits, as 32 hex digits
+
+        // look up the verdict, and the example if one is needed (-e)
+        static bool lookup(const std::string& key, bool example, bool& verdict, Valuation& valuation);
+        static void store(const std::string& key, bool example, bool verdict, const Valuation& valuation);
+};
+
+#endif // CACHE_H
@@ -0,0 +1,117 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include "checkpoint.hpp"
+#include "settings.hpp"
+
+using std::endl;
+using namespace std::chrono;
+
+static const char MAGIC[8] = {'Q','U','B','I','C','K','P','1'};
+
+static std::ofstream output;
+static std::ifstream resumed;
+static steady_clock::time_point last = steady_clock::now();
+
+// FNV-1a over the prefix, the gates and the output, and the options that
+// determine the state of the Solver
+uint64_t Checkpoint::fingerprint(const Circuit& c) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto mix = [&h](int64_t x) { h = (h ^ (uint64_t)x) * 0x100000001b3ULL; };
+    mix(c.maxVar()); mix(c.maxGate()); mix(c.getOutput());
+    mix(ITERATE); mix(PARTITION > 0); mix(DONTCARE); mix(ORDER); mix(QUANTIFY);
+    mix(GARBAGE); mix(APPROX);
+    for (int i=0; i<c.maxBlock(); i++) {
+        mix(c.getBlock(i).quantifier);
+        for (int x : c.getBlock(i).variables) mix(x);
+    }
+    for (int i=c.maxVar(); i<c.maxGate(); i++) {
+        const Gate& g = c.getGate(i);
+        mix(g.output);
+        for (int x : g.quants) mix(x);
+        mix(0);
+        for (int arg : g.inputs) mix(arg);
+    }
+    return h;
+}
+
+bool Checkpoint::due() {
+    if (CHECKPOINT == "" || steady_clock::now() - last < seconds(PERIOD)) return false;
+    last = steady_clock::now();
+    return true;
+}
+
+std::ostream& Checkpoint::create(const Circuit& c, Phase phase) {
+    output.open(CHECKPOINT + ".tmp", std::ios::binary | std::ios::trunc);
+    const uint64_t print = fingerprint(c);
+    const int32_t p = phase;
+    output.write(MAGIC, sizeof(MAGIC));
+    output.write(reinterpret_cast<const char*>(&print), sizeof(print));
+    output.write(reinterpret_cast<const char*>(&p), sizeof(p));
+    return output;
+}
+
+void Checkpoint::commit() {
+    output.close();
+    if (output.fail() || rename((CHECKPOINT + ".tmp").c_str(), CHECKPOINT.c_str()) != 0) {
+        LOG(0, "Warning: could not write checkpoint \"" << CHECKPOINT << "\"" << endl);
+        output.clear();
+    } else
+        LOG(1, "[checkpoint]");
+    last = steady_clock::now(); // the period starts after writing
+}
+
+Checkpoint::Phase Checkpoint::open(const Circuit& c) {
+    if (RESUME == "") return none;
+    const std::string name = RESUME;
+    RESUME = ""; // only the first Solver resumes
+    resumed.open(name, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    uint64_t print;
+    int32_t phase;
+    if (!resumed.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        !resumed.read(reinterpret_cast<char*>(&print), sizeof(print)) ||
+        !resumed.read(reinterpret_cast<char*>(&phase), sizeof(phase)) ||
+        (phase != gates && phase != blocks)) {
+        resumed.close();
+        throw CheckpointError("\"" + name + "\" is not a checkpoint");
+    }
+    if (print != fingerprint(c)) {
+        resumed.close();
+        throw CheckpointError("checkpoint \"" + name + "\" belongs to another circuit, or other options");
+    }
+    LOG(1, "Resuming from checkpoint \"" << name << "\"" << endl);
+    return (Phase)phase;
+}
+
+std::istream& Checkpoint::input() {
+    return resumed;
+}
+
+void Checkpoint::close() {
+    resumed.close();
+}
+
+void Checkpoint::damaged() {
+    resumed.close();
+    throw CheckpointError("the checkpoint is damaged");
+}
+
+void Checkpoint::writeInts(std::ostream& out, const vector<int>& ints) {
+    const uint32_t size = ints.size();
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char*>(ints.data()), ints.size()*sizeof(int));
+}
+
+vector<int> Checkpoint::readInts(std::istream& in) {
+    uint32_t size;
+    if (!in.read(reinterpret_cast<char*>(&size), sizeof(size))) damaged();
+    vector<int> ints(size);
+    if (!in.read(reinterpret_cast<char*>(ints.data()), size*sizeof(int))) damaged();
+    return ints;
+}
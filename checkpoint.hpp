@@ -0,0 +1,47 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include "circuit.hpp"
+
+// Checkpoints of a long solve (-checkpoint=file, every -period seconds), to
+// continue from after an interruption (-resume=file). A checkpoint has a
+// header, which identifies the circuit and the phase of the Solver, and the
+// state of that phase: arrays of integers and BDDs (see Bdd_base::Write).
+// Resuming requires the same circuit, so the same input and transformations.
+// A checkpoint is written to a temporary file, which is then renamed, so an
+// interruption never leaves a damaged checkpoint behind.
+// A checkpoint that cannot be resumed from throws CheckpointError.
+
+class CheckpointError : public std::runtime_error {
+    public:
+        CheckpointError(const std::string& message) : std::runtime_error(message) { }
+};
+
+class Checkpoint {
+    public:
+        enum Phase {none, gates, blocks}; // Solver::gates2bdd, Solver::prefix2bdd
+
+        static bool due(); // the period has passed since the last checkpoint
+        static std::ostream& create(const Circuit& c, Phase phase); // a new checkpoint
+        static void commit(); // complete it
+
+        // the phase of the checkpoint to resume from (-resume), which must match the circuit
+        static Phase open(const Circuit& c);
+        static std::istream& input();
+        static void close();
+        [[noreturn]] static void damaged();
+
+        static void writeInts(std::ostream& out, const vector<int>& ints);
+        static vector<int> readInts(std::istream& in);
+
+    private:
+        static uint64_t fingerprint(const Circuit& c);
+};
+
+#endif // CHECKPOINT_H
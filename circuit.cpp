@@ -4,7 +4,9 @@
 #include <iostream>
 #include <assert.h>
 #include <algorithm>
+#include <cstdint>
 #include "circuit.hpp"
+#include "watchdog.hpp"
 #include "settings.hpp"
 #include "messages.hpp"
 
@@ -112,7 +114,21 @@ void Circuit::gather(int gate, int sign, vector<int>& args) {
     }
 }
 
-// Flatten and/or starting in matrix, starting from gate. 
+// Gather all args under nested xor gates, as in xor(a, -xor(b,c)) = -xor(a,b,c);
+// a negation (sign) is moved to the first argument gathered by this call
+void Circuit::gatherXor(int gate, int sign, vector<int>& args) {
+    Gate g = getGate(gate);
+    size_t start = args.size();
+    for (int arg : g.inputs) {
+        if (abs(arg) >= maxvar && getGate(abs(arg)).output == Xor && getGate(abs(arg)).size() > 0)
+            gatherXor(abs(arg), (arg > 0 ? 1 : -1), args);
+        else
+            args.push_back(arg);
+    }
+    if (sign < 0) args[start] = -args[start];
+}
+
+// Flatten and/or/xor starting in matrix, starting from gate. 
 // This operation proceeds recursively, and completely in-situ.
 // Note: after this operation, the matrix may have unused gates
 // TODO: need cache/marking?
@@ -121,15 +137,21 @@ void Circuit::flatten_rec(int gate) {
     assert(gate>0);
     if (gate >= maxVar()) {
         Gate &g = matrix[gate-maxvar]; // cannot use getGate since we will update g
-        if (g.output==And || g.output==Or) {
+        if (g.output==And || g.output==Or || g.output==Xor) {
             vector<int> newgates;
-            gather(gate, 1, newgates);
+            if (g.output==Xor)
+                gatherXor(gate, 1, newgates);
+            else
+                gather(gate, 1, newgates);
             g.inputs = newgates;
             for (int arg : newgates) flatten_rec(abs(arg));
         }
         else if (g.output==All || g.output==Ex) {
             flatten_rec(abs(g.inputs[0]));
         }
+        else if (g.output==Ite) {
+            for (int arg : g.inputs) flatten_rec(abs(arg));
+        }
         else assert(false);
     }
 }
@@ -142,7 +164,7 @@ Circuit& Circuit::flatten() {
 
 void Circuit::mark(int gate, std::set<int>& marking) { 
     assert(gate>0);
-    marking.insert(gate);
+    if (!marking.insert(gate).second) return; // shared gate, already visited
     if (gate >= maxVar()) 
         for (int arg : getGate(gate).inputs)
             mark(abs(arg), marking);
@@ -229,6 +251,35 @@ Circuit& Circuit::cleanup_matrix() {
     return permute(reordering); // update all indices, also updates output
 }
 
+// Replace the matrix by the conjunction of the clauses; old gates are removed
+Circuit& Circuit::setClauses(const vector<vector<int>>& clauses) {
+    vector<int> args;
+    for (const vector<int>& clause : clauses)
+        args.push_back(addGate(Gate(Or, clause)));
+    output = addGate(Gate(And, args));
+    return cleanup_matrix();
+}
+
+// Replace gate i by lits[i], an equivalent literal of an earlier variable or
+// gate. Gate i is kept if lits[i]==0, and becomes constant true (false) if
+// lits[i]==i (-i). The replaced gates are removed.
+Circuit& Circuit::merge(const vector<int>& lits) {
+    const auto get = [&lits](int lit) {
+        int i = abs(lit);
+        int result = (lits[i] == 0 || abs(lits[i]) == i ? i : lits[i]);
+        return (lit > 0 ? result : -result);
+    };
+    for (int i=maxVar(); i<maxGate(); i++) {
+        Gate& g = matrix[i-maxvar];
+        if (abs(lits[i]) == i)
+            g = Gate(lits[i] > 0 ? And : Or, vector<int>());
+        else
+            for (int& arg : g.inputs) arg = get(arg);
+    }
+    output = get(output);
+    return cleanup_matrix();
+}
+
 // Apply the reordering and store its inverse
 // The reordering applies to variables and possibly to gates
 Circuit& Circuit::permute(std::vector<int>& reordering) {
@@ -342,6 +393,87 @@ Circuit& Circuit::reorderMatrix() {
     return permute(reordering);
 }
 
+// Eliminate variables from the interaction graph by min-fill, inner
+// blocks first, so the order respects the prefix. Two variables interact
+// if they occur in the same top-level argument of the output. The neighbours
+// of an eliminated variable form a bag of the tree decomposition. The first
+// eliminated variable gets the highest index, so quantifying in decreasing
+// index order (-a=3) follows the buckets.
+
+Circuit& Circuit::reorderTree() {
+    LOG(1, "Reordering Variables (Tree decomposition)" << std::endl)
+    Watchdog::phase("reordering (tree decomposition)", "variable");
+    const int first = maxVar();
+    vector<int> roots({abs(output)});
+    if (abs(output) >= first && (getGate(abs(output)).output == And || getGate(abs(output)).output == Or))
+        roots = getGate(abs(output)).inputs;
+
+    vector<std::set<int>> graph(first);         // the interaction graph
+    vector<int> visited(maxGate(), -1);
+    for (size_t r=0; r<roots.size(); r++) {     // support of each root is a clique
+        vector<int> support, todo({abs(roots[r])});
+        while (todo.size()>0) {
+            int i = todo.back(); todo.pop_back();
+            if (visited[i] == (int)r) continue;
+            visited[i] = r;
+            if (i < first) support.push_back(i);
+            else for (int arg : getGate(i).inputs) todo.push_back(abs(arg));
+        }
+        for (int x : support)
+            for (int y : support)
+                if (x != y) graph[x].insert(y);
+    }
+
+    // number of missing edges between the neighbours of x, up to limit
+    auto fill = [&graph](int x, size_t limit) {
+        size_t count = 0;
+        for (auto a=graph[x].begin(); a!=graph[x].end() && count<=limit; a++)
+            for (auto b=std::next(a); b!=graph[x].end(); b++)
+                if (graph[*a].count(*b)==0) count++;
+        return count;
+    };
+
+    vector<vector<int>> stages; // variables per block, innermost first, free variables last
+    vector<bool> bound(first, false);
+    for (int i=maxBlock()-1; i>=0; i--) {
+        stages.push_back(getBlock(i).variables);
+        for (int x : getBlock(i).variables) bound[x] = true;
+    }
+    stages.push_back(vector<int>());
+    for (int x=1; x<first; x++)
+        if (!bound[x]) stages.back().push_back(x);
+
+    int next = first-1;                        // next variable index to use
+    vector<int> reordering(first, 0);
+    size_t width = 0;
+    for (vector<int>& todo : stages) {
+        while (todo.size()>0) {
+            size_t best = 0, bestfill = 0;
+            for (size_t k=0; k<todo.size(); k++) {
+                size_t f = fill(todo[k], k==0 ? SIZE_MAX : bestfill);
+                if (k==0 || f < bestfill || (f == bestfill && graph[todo[k]].size() < graph[todo[best]].size())) {
+                    best = k; bestfill = f;
+                }
+            }
+            int x = todo[best];
+            Watchdog::check(x);
+            todo.erase(todo.begin()+best);
+            width = std::max(width, graph[x].size());
+            for (int a : graph[x]) {            // the neighbours become a clique
+                graph[a].erase(x);
+                for (int b : graph[x])
+                    if (a != b) graph[a].insert(b);
+            }
+            graph[x].clear();
+            reordering[x] = next--;
+        }
+    }
+    assert(next == 0);
+    LOG(2, "- elimination width " << width << std::endl);
+
+    return permute(reordering);
+}
+
 Circuit& Circuit::prefix2circuit() {
     LOG(1, "Moving quantifiers to top of matrix" << std::endl)
     while (maxBlock()>1) { // keep outermost block...
@@ -374,10 +506,16 @@ vector<varset> Circuit::posneg() {
     for (int i=maxVar(); i<maxGate(); i++) {
         varset pos;
         varset neg;
-        // this works for And, Or, All, Ex
-        // this must change when we add xor and ite
-        for (int lit : getGate(i).inputs) {
-            if (lit > 0) { 
+        // And, Or, All, Ex are monotone in their inputs, and so are the
+        // branches of Ite; the inputs of Xor and the condition of Ite occur
+        // in both polarities
+        const Gate& g = getGate(i);
+        for (size_t k=0; k<g.inputs.size(); k++) {
+            int lit = g.inputs[k];
+            if (g.output == Xor || (g.output == Ite && k == 0)) {
+                pos |= possets[abs(lit)] | negsets[abs(lit)];
+                neg |= possets[abs(lit)] | negsets[abs(lit)];
+            } else if (lit > 0) { 
                 pos |= possets[lit];
                 neg |= negsets[lit];
             } else {
@@ -448,10 +586,10 @@ int Circuit::buildQuant(Connective q, const vector<int>& xs, int gate) {
 }
 
 // TODO: needs an operations cache?
-int Circuit::bringitdown(Quantifier q, int x, int gate, const vector<varset>& dependencies) {
+int Circuit::bringitdown(Quantifier q, int x, int gate, const vector<varset>& dependencies, Pushed& pushed) {
 
     if (gate<0) { // handle negative edges by dual quantifier
-        return -bringitdown(dualQ(q), x, -gate, dependencies); 
+        return -bringitdown(dualQ(q), x, -gate, dependencies, pushed);
     }
     // below this line gate>0
     if (gate < maxVar()) { // the gate is a single input variable (leaf of circuit)
@@ -467,7 +605,12 @@ int Circuit::bringitdown(Quantifier q, int x, int gate, const vector<varset>& de
             return gate; // ignore quantifier as in Exist/Forall x (y)
         }
     }
+    auto done = pushed.find({q, gate});
+    if (done != pushed.end()) return done->second;
+    return pushed[{q, gate}] = pushgate(q, x, gate, dependencies, pushed);
+}
 
+int Circuit::pushgate(Quantifier q, int x, int gate, const vector<varset>& dependencies, Pushed& pushed) {
     Gate g = getGate(gate);
     LOG(3,"- Pushing " << Qtext[q] << " " << varString(x) 
             << " over gate " << varString(gate) << " ("<< Ctext[g.output] << ")" << std::endl);
@@ -483,7 +626,7 @@ int Circuit::bringitdown(Quantifier q, int x, int gate, const vector<varset>& de
         for (int arg: g.inputs) {
             int newarg = arg;
             if (dependencies[abs(arg)][x]) { // push quantifier into dependent arguments
-                newarg = bringitdown(q, x, arg, dependencies);
+                newarg = bringitdown(q, x, arg, dependencies, pushed);
             }
             newargs.push_back(newarg);
         }
@@ -510,7 +653,7 @@ int Circuit::bringitdown(Quantifier q, int x, int gate, const vector<varset>& de
             int newarg;
             if (args_pos.size()==1) {
                     // push quantifier into the only dependent argument
-                newarg = bringitdown(q, x, args_pos[0], dependencies);
+                newarg = bringitdown(q, x, args_pos[0], dependencies, pushed);
             }
             else {// make two new gates for the dependent arguments
                 newarg = addGate(Gate(g.output, args_pos));
@@ -526,9 +669,51 @@ int Circuit::bringitdown(Quantifier q, int x, int gate, const vector<varset>& de
         }
     }
 
+    if (g.output==Xor) {
+        // split args in dependent and independent args, and case split on the latter
+        // As in Exists x (A1(x) ^ A2) ==> ite(A2, Exists x !A1(x), Exists x A1(x))
+        vector<int> args_dep, args_indep;
+        for (int arg : g.inputs) {
+            if (dependencies[abs(arg)][x])
+                args_dep.push_back(arg);
+            else
+                args_indep.push_back(arg);
+        }
+        if (args_dep.size()==0) {
+            return gate; // the quantified variable doesn't occur, just drop quantifier
+        }
+        int newarg = (args_dep.size()==1 ? args_dep[0] : addGate(Gate(Xor, args_dep)));
+        const auto quantify = [&](int arg) { // push into a single dependent argument
+            if (args_dep.size()==1)
+                return bringitdown(q, x, arg, dependencies, pushed);
+            return addGate(Gate(Quant2Conn(q), vector<int>({x}), vector<int>({arg})));
+        };
+        int pos = quantify(newarg);
+        if (args_indep.size()==0) {
+            return pos;
+        }
+        int neg = quantify(-newarg);
+        int cond = (args_indep.size()==1 ? args_indep[0] : addGate(Gate(Xor, args_indep)));
+        return addGate(Gate(Ite, vector<int>({cond, neg, pos})));
+    }
+
+    if (g.output==Ite) {
+        // push the quantifier into both branches, if the condition doesn't depend on x
+        // As in Exists x ite(C, A(x), B(x)) ==> ite(C, Exists x A(x), Exists x B(x))
+        if (dependencies[abs(g.inputs[0])][x]) {
+            return addGate(Gate(Quant2Conn(q), vector<int>({x}), vector<int>({gate})));
+        }
+        vector<int> newargs({g.inputs[0]});
+        for (int k=1; k<3; k++) {
+            int arg = g.inputs[k];
+            newargs.push_back(dependencies[abs(arg)][x] ? bringitdown(q, x, arg, dependencies, pushed) : arg);
+        }
+        return addGate(Gate(Ite, newargs));
+    }
+
     if (g.output==All || g.output==Ex) {
         if (g.output == Quant2Conn(q)) { // push new quantifier through the (same) old quantifier
-            int new_arg = bringitdown(q, x, g.inputs[0], dependencies);
+            int new_arg = bringitdown(q, x, g.inputs[0], dependencies, pushed);
             return buildQuant(g.output, g.quants, new_arg);
         } else { // Just add the quantifier
             return addGate(Gate(Quant2Conn(q), vector<int>({x}), vector<int>({gate})));
@@ -538,8 +723,155 @@ int Circuit::bringitdown(Quantifier q, int x, int gate, const vector<varset>& de
     assert(false);
 }
 
+// Build gate conn(args), with constants (literals of the gate T = and())
+// propagated, and structurally hashed. Returns an equivalent literal.
+int Circuit::simplify(Connective conn, const vector<int>& quants, const vector<int>& args, int T, Hashed& hashed) {
+    if (conn==And || conn==Or) {
+        const int unit = (conn==And ? T : -T);
+        vector<int> newargs;
+        for (int arg : args) {
+            if (arg == -unit) return -unit; // absorbing element
+            if (arg != unit) newargs.push_back(arg);
+        }
+        if (newargs.size()==0) return unit;
+        if (newargs.size()==1) return newargs[0];
+        auto key = pair(pair(conn, newargs), quants);
+        if (hashed.count(key)==0) hashed[key] = addGate(Gate(conn, quants, newargs));
+        return hashed[key];
+    } else if (conn==Xor) {
+        int sign = 1;
+        vector<int> newargs;
+        for (int arg : args) {
+            if (abs(arg) == T) sign = (arg == T ? -sign : sign); // true flips the parity
+            else newargs.push_back(arg);
+        }
+        if (newargs.size()==0) return -sign*T;
+        if (newargs.size()==1) return sign*newargs[0];
+        auto key = pair(pair(conn, newargs), quants);
+        if (hashed.count(key)==0) hashed[key] = addGate(Gate(conn, quants, newargs));
+        return sign*hashed[key];
+    } else if (conn==Ite) {
+        if (abs(args[0]) == T) return (args[0] == T ? args[1] : args[2]);
+        if (args[1] == args[2]) return args[1];
+        auto key = pair(pair(conn, args), quants);
+        if (hashed.count(key)==0) hashed[key] = addGate(Gate(conn, quants, args));
+        return hashed[key];
+    } else {
+        if (abs(args[0]) == T) return args[0]; // quantifier over constant
+        auto key = pair(pair(conn, args), quants);
+        if (hashed.count(key)==0) hashed[key] = addGate(Gate(conn, quants, args));
+        return hashed[key];
+    }
+}
+
+// Expand a variable x of the innermost universal block (or else of the innermost
+// block), but never of the outermost quantifier. The blocks inside x move into both
+// cofactors as quantifier gates, as in:
+// Forall x Exists Y (M) ==> Exists Y (M[x:=0]) /\ Exists Y (M[x:=1])
+// Exists x is expanded by \/. We take the x with the smallest cone of gates.
+// Both cofactors share the gates that don't depend on x, and their new gates
+// are simplified and structurally hashed. Returns false if nothing was expanded.
+
+bool Circuit::expand() {
+    int top = 0; // the outermost blocks up to the first alternation are kept for the example
+    while (top < maxBlock() && prefix[top].quantifier == prefix[0].quantifier) top++;
+    int j = maxBlock()-1;
+    while (j>=top && prefix[j].quantifier != Forall) j--;
+    if (j<top) j = maxBlock()-1;
+    if (j<top || maxVar() > (int)varset().size()) return false;
+
+    const int first = maxVar();
+    const int last = maxGate();
+    vector<varset> deps = posneg();
+    vector<bool> reach(last, false);
+    reach[abs(output)] = true;
+    for (int i=last-1; i>=first; i--)
+        if (reach[i])
+            for (int arg : getGate(i).inputs) reach[abs(arg)] = true;
+
+    Block& b = prefix[j];
+    int x = b.variables[0];
+    int best = -1;
+    for (int y : b.variables) {
+        int cone = 0;
+        for (int i=first; i<last; i++)
+            if (reach[i] && deps[i][y]) cone++;
+        if (best<0 || cone<best) { x = y; best = cone; }
+    }
+    LOG(1,"Expanding " << Qtext[b.quantifier] << " " << varString(x) 
+        << " (cone of " << best << " gates)" << std::endl);
+
+    const int T = addGate(Gate(And, vector<int>())); // true
+    Hashed hashed;
+    const auto build = [&](Connective conn, const vector<int>& quants, const vector<int>& args) {
+        return simplify(conn, quants, args, T, hashed);
+    };
+
+    vector<int> copies;
+    for (bool value : {false, true}) {
+        map<int,int> sub; // gates depending on x -> their cofactor
+        const auto get = [&](int lit) {
+            int i = abs(lit);
+            int result = (i==x ? (value ? T : -T) : (sub.count(i)>0 ? sub[i] : i));
+            return (lit>0 ? result : -result);
+        };
+        for (int i=first; i<last; i++) {
+            if (!reach[i] || !deps[i][x]) continue;
+            Gate g = getGate(i); // copy, since build may add gates
+            vector<int> args;
+            for (int arg : g.inputs) args.push_back(get(arg));
+            sub[i] = build(g.output, g.quants, args);
+        }
+        int copy = get(output);
+        for (int k=maxBlock()-1; k>j; k--)
+            copy = build(Quant2Conn(prefix[k].quantifier), prefix[k].variables, vector<int>({copy}));
+        copies.push_back(copy);
+    }
+    output = build(b.quantifier==Forall ? And : Or, vector<int>(), copies);
+
+    prefix.erase(prefix.begin()+j+1, prefix.end());
+    vector<int>& vars = prefix[j].variables;
+    vars.erase(std::find(vars.begin(), vars.end(), x));
+    if (vars.size()==0) prefix.pop_back();
+    cleanup_matrix();
+    return true;
+}
+
+// Replace the variables of the cube by constants, and propagate them through
+// the gates. The variables are removed from the prefix (with empty blocks).
+Circuit& Circuit::assign(const Valuation& cube) {
+    const int first = maxVar();
+    const int last = maxGate();
+    const int T = addGate(Gate(And, vector<int>())); // true
+    Hashed hashed;
+    map<int,int> sub; // variables/gates -> new literal
+    for (auto [x, value] : cube) sub[x] = (value ? T : -T);
+    const auto get = [&sub](int lit) {
+        int i = abs(lit);
+        int result = (sub.count(i)>0 ? sub[i] : i);
+        return (lit>0 ? result : -result);
+    };
+    for (int i=first; i<last; i++) {
+        Gate g = getGate(i); // copy, since simplify may add gates
+        vector<int> args;
+        for (int arg : g.inputs) args.push_back(get(arg));
+        sub[i] = simplify(g.output, g.quants, args, T, hashed);
+    }
+    output = get(output);
+
+    vector<Block> newprefix;
+    for (Block& b : prefix) {
+        vector<int>& vars = b.variables;
+        vars.erase(std::remove_if(vars.begin(), vars.end(), [&sub](int x) { return sub.count(x)>0; }), vars.end());
+        if (vars.size()>0) newprefix.push_back(b);
+    }
+    prefix = newprefix;
+    return cleanup_matrix();
+}
+
 Circuit& Circuit::miniscope() {
     LOG(1,"Moving quantifiers inside (early quantification)" << std::endl);
+    Watchdog::phase("miniscoping", "variable");
     while (maxBlock()>1) {
         Block b = prefix.back();
         vector<int> xs = b.variables;
@@ -556,7 +888,9 @@ Circuit& Circuit::miniscope() {
             std::stable_sort(xs.begin(), xs.end(), cmp);       
         }
         for (int var : xs) {
-            output = bringitdown(b.quantifier, var, output, posneg());
+            Watchdog::check(var);
+            Pushed pushed;
+            output = bringitdown(b.quantifier, var, output, posneg(), pushed);
             cleanup_matrix();
         }
         prefix.pop_back();
@@ -18,9 +18,9 @@ using std::string;
 using std::pair;
 using std::set;
 
-enum Connective {And, Or, All, Ex};
-constexpr array<Connective,4> Connectives = {And, Or, All, Ex};
-const array<string,4> Ctext = {"and", "or", "forall", "exists"};
+enum Connective {And, Or, All, Ex, Xor, Ite};
+constexpr array<Connective,6> Connectives = {And, Or, All, Ex, Xor, Ite};
+const array<string,6> Ctext = {"and", "or", "forall", "exists", "xor", "ite"};
 
 enum Quantifier {Forall, Exists};
 constexpr array<Quantifier,2> Quantifiers = {Forall, Exists};
@@ -30,6 +30,7 @@ typedef vector<pair<int,bool>> Valuation; // ordered list of pairs var->bool
 
 // A Gate is a logical connective applied to a vector of inputs
 // (negative numbers indicate logical negation)
+// (xor is the parity of its inputs, ite(c,t,e) has exactly 3 inputs)
 // (the connective can be a quantifier with a vector of variables (non-prenex))
 
 class Gate {
@@ -102,23 +103,34 @@ public:
 
     Circuit& split();           // every block gets single quantifier
     Circuit& combine();         // blocks become strictly alternating
-    Circuit& flatten();         // flatten and/or gates (and/or become alternating)
+    Circuit& flatten();         // flatten and/or/xor gates (and/or become alternating)
     Circuit& cleanup();         // remove unused variables / gates. ONLY FOR PRENEX FORM
     Circuit& reorderDfs();      // reorder by order of appearance in DFS pass
     Circuit& reorderMatrix();   // reorder by order of appearance in matrix
+    Circuit& reorderTree();     // reorder by min-fill elimination, inner blocks first
     Circuit& prefix2circuit();  // move prefix on top of circuit gates
     Circuit& miniscope();       // move prefix down into circuit gates
+    bool expand();              // expand an inner variable into two cofactors
+    Circuit& assign(const Valuation& cube); // cofactor: variables become constants
+    Circuit& setClauses(const vector<vector<int>>& clauses); // matrix becomes CNF. ONLY FOR PRENEX FORM
+    Circuit& merge(const vector<int>& lits); // replace gates by equivalent literals (see Sweeper)
 
 private:
     Circuit& permute(vector<int>& reordering); // store and apply reordering
     void flatten_rec(int gate);
     void gather(int gate, int sign, vector<int>& args); // gather args with same connective 
+    void gatherXor(int gate, int sign, vector<int>& args); // gather args of nested xors
     void mark(int gate, set<int>& mark); // mark all reachable variables and gates from gate
     vector<varset> posneg(); // compute positive / negative input dependencies per gate
-    int bringitdown(Quantifier q, int x, int gate, const vector<varset>& dependencies);   
+    typedef map<pair<Quantifier,int>,int> Pushed; // (q, gate) -> new gate, for one variable x
+    int bringitdown(Quantifier q, int x, int gate, const vector<varset>& dependencies, Pushed& pushed);
         // move quantifier (q x) into circuit below (gate), return new gate.
         // use the input-variable dependencies for each gate.
+        // each (q, gate) is pushed once, shared subcircuits (e.g. xor chains) stay linear
+    int pushgate(Quantifier q, int x, int gate, const vector<varset>& dependencies, Pushed& pushed);
     Circuit& cleanup_matrix();  // Only cleanup matrix. Can be used for NON-PRENEX as well
+    typedef map<pair<pair<Connective,vector<int>>,vector<int>>,int> Hashed; // (conn, args), quants -> gate
+    int simplify(Connective conn, const vector<int>& quants, const vector<int>& args, int T, Hashed& hashed);
 
 };
 
@@ -131,8 +131,12 @@ bool find_keyword(string& line, const string& keyword) {
 Gate CircuitRW::readGate(string& line) const {
     for (Connective q : Connectives) {
         string ctext = Ctext[q];
-        if (find_keyword(line, ctext))
-            return Gate(q, readLiterals(line));
+        if (find_keyword(line, ctext)) {
+            string args = line;
+            Gate g(q, readLiterals(line));
+            assertThrow(q != Ite || g.size() == 3, ArityError(args, lineno));
+            return g;
+        }
     }
     // the line didn't match
     assertThrow(false, ConnectiveError(line, lineno));
@@ -186,9 +190,9 @@ void removeWhiteSpace(string& line) {
     line.erase(p2, line.end());
 }
 
+// throws a QBFexception on errors in the input
 void CircuitRW::readQcir(istream &input) {
     string line;
-try {
     while (getline(input, line)) {
         lineno++;
         
@@ -212,9 +216,4 @@ try {
     smatch m;
     if (regex_search(line, m, regex(literal)))
         setOutput(readLiteral(m[0]));
-}
-catch (QBFexception& err) { 
-    cout << err.what() << endl; 
-    exit(-1);
-}
 }
\ No newline at end of file
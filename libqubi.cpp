@@ -0,0 +1,204 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <iostream>
+#include <optional>
+#include <functional>
+#include <exception>
+#include "libqubi.hpp"
+#include "solver.hpp"
+#include "solver_tt.hpp"
+#include "solver_zdd.hpp"
+#include "solver_cegar.hpp"
+#include "symmetry.hpp"
+#include "sweep.hpp"
+#include "watchdog.hpp"
+#include "cache.hpp"
+#include "bdd_sylvan.hpp"
+#include "bdd_builtin.hpp"
+#include "settings.hpp"
+
+using std::endl;
+using std::cerr;
+
+// the global settings (settings.hpp), see Options for their defaults
+
+int VERBOSE     = Options().verbose;
+int ITERATE     = Options().iterate;
+int PARTITION   = Options().partition;
+int DONTCARE    = Options().dontcare;
+int ORDER       = Options().order;
+int QUANTIFY    = Options().quantify;
+int ZDD         = Options().zdd;
+int BUDGET      = Options().budget;
+int APPROX      = Options().approx;
+bool KEEPNAMES  = Options().keepnames;
+bool GARBAGE    = Options().garbage;
+string CHECKPOINT = "";
+string RESUME   = "";
+string DUMP     = "";
+string CACHE    = "";
+int PERIOD      = Options().period;
+
+bool STATISTICS = false;
+size_t PEAK = 0;
+
+void Options::apply() const {
+    VERBOSE    = verbose;
+    ITERATE    = iterate;
+    PARTITION  = partition;
+    DONTCARE   = dontcare;
+    ORDER      = order;
+    QUANTIFY   = quantify;
+    ZDD        = zdd;
+    BUDGET     = budget;
+    APPROX     = approx;
+    KEEPNAMES  = keepnames;
+    GARBAGE    = garbage;
+    CHECKPOINT = checkpoint;
+    RESUME     = resume;
+    DUMP       = dump;
+    CACHE      = cache;
+    PERIOD     = period;
+    STATISTICS = statistics;
+}
+
+// The BDD managers of the session, opened on first use
+static std::optional<Builtin_mgr> builtinmgr;
+static std::optional<Sylvan_mgr> sylvanmgr;
+
+Qubi::Qubi(const Options& options) : options(options) {
+    options.apply();
+}
+
+Qubi::~Qubi() {
+    sylvanmgr.reset();
+    builtinmgr.reset();
+}
+
+// Solve with BDDs. When a BDD exceeds the budget (-n), expand a variable
+// and start again on the expanded circuit.
+template <class BDD>
+bool solve_bdd(Circuit& qbf, Valuation& valuation, bool example) {
+    while (true) {
+        {
+            Solver<BDD> solver(qbf);
+            bool verdict = solver.solve();
+            if (!solver.exceeded()) {
+                if (example) valuation = solver.example();
+                return verdict;
+            }
+        }
+        BDD::gc();
+        if (!qbf.expand()) {
+            LOG(1,"Nothing left to expand: continue without budget" << endl);
+            BUDGET = 0;
+        }
+        if (VERBOSE>=1) qbf.printInfo(cerr);
+    }
+}
+
+// Exceptions (e.g. Stopped) cannot leave a Lace task: they are caught in
+// the task, and thrown again outside
+static std::exception_ptr failure;
+
+TASK_1(int, sylvan_task, const std::function<int()>*, f) {
+    try {
+        return (*f)();
+    } catch (...) {
+        failure = std::current_exception();
+        return 0;
+    }
+}
+
+static int runSylvan(const std::function<int()>& f) {
+    failure = nullptr;
+    int result = RUN(sylvan_task, &f);
+    if (failure) std::rethrow_exception(failure);
+    return result;
+}
+
+// Transformations of the circuit, before printing or solving
+void Qubi::transform(Circuit& qbf) {
+    options.apply();
+    Watchdog::phase("transforming");
+    if (options.quantblocks==Options::split) qbf.split();
+    if (options.quantblocks==Options::combine) qbf.combine();
+    if (options.flatten) qbf.flatten();
+    if (options.cleanup) qbf.cleanup();
+    if (VERBOSE>=1 && (options.cleanup || options.quantblocks>0)) qbf.printInfo(cerr);
+    if (options.reorder==Options::dfs) qbf.reorderDfs();
+    if (options.reorder==Options::matrix) qbf.reorderMatrix();
+    if (options.reorder==Options::tree) qbf.reorderTree();
+    Watchdog::check();
+    if (options.symmetry>0) {
+        if (Symmetry::applicable(qbf))
+            Symmetry(qbf).breakSymmetries(options.symmetry);
+        else
+            LOG(1,"Circuit is not prenex: no symmetry breaking" << endl);
+    }
+    if (options.prefix>0) {
+        if (options.prefix==Options::circuit) qbf.prefix2circuit();
+        if (options.prefix==Options::miniscope) qbf.miniscope();
+        if (VERBOSE>=1) qbf.printInfo(cerr);
+    }
+    Watchdog::check();
+    if (options.sweep>0) {
+        if (options.backend == Options::builtinbdd) {
+            if (!builtinmgr) builtinmgr.emplace(options.table, options.memory);
+            Sweeper<Builtin_Bdd>(qbf).sweep(options.sweep);
+        } else {
+            if (!sylvanmgr) sylvanmgr.emplace(options.workers, options.table, options.memory, qbf.maxGate());
+            runSylvan([&]() { return Sweeper<Sylvan_Bdd>(qbf).sweep(options.sweep); });
+        }
+        if (VERBOSE>=1) qbf.printInfo(cerr);
+    }
+}
+
+// Options that only the BDD solver implements: with any of them, small
+// instances are not solved by truth tables
+static bool bddOptions(const Options& o) {
+    return o.partition > 0 || o.budget > 0 || o.approx > 0 || o.iterate != Options::pairwise
+        || o.order != Options::inputs || o.quantify != Options::cube || o.dontcare != Options::off
+        || !o.garbage || o.backend != Options::sylvanbdd || o.checkpoint != "" || o.resume != "" || o.dump != "";
+}
+
+// The BDDs left behind by a previous circuit are collected first. After a
+// stop, the session goes on: they are collected, and the alarm is cleared.
+bool Qubi::solve(Circuit& qbf, Valuation& valuation) {
+    options.apply();
+    PEAK = 0;
+    bool verdict;
+    string key;
+    if (CACHE != "") {
+        key = Cache::key(qbf);
+        if (Cache::lookup(key, options.example, verdict, valuation)) return verdict;
+    }
+    try {
+        if (ZDD > 0) ZDD_Solver(qbf).eliminate(); // the remaining clauses are solved below
+        if (options.engine == Options::cegar && !CEGAR_Solver::applicable(qbf))
+            LOG(1,"Circuit is not prenex: CEGAR engine not applicable" << endl);
+        if (options.engine == Options::cegar && CEGAR_Solver::applicable(qbf)) {
+            CEGAR_Solver solver(qbf);
+            verdict = solver.solve();
+            if (options.example) valuation = solver.example();
+        } else if (qbf.maxVar()-1 <= options.truthtable && !bddOptions(options)) { // small instance: no need to start Sylvan
+            TT_Solver solver(qbf);
+            verdict = solver.solve();
+            if (options.example) valuation = solver.example();
+        } else if (options.backend == Options::builtinbdd) {
+            if (builtinmgr) Builtin_Bdd::gc(); else builtinmgr.emplace(options.table, options.memory);
+            verdict = solve_bdd<Builtin_Bdd>(qbf, valuation, options.example);
+        } else {
+            if (sylvanmgr) Sylvan_Bdd::gc(); else sylvanmgr.emplace(options.workers, options.table, options.memory, qbf.maxGate());
+            verdict = runSylvan([&]() { return solve_bdd<Sylvan_Bdd>(qbf, valuation, options.example); });
+        }
+    } catch (const Stopped&) {
+        if (builtinmgr) Builtin_Bdd::gc();
+        if (sylvanmgr) Sylvan_Bdd::gc();
+        Watchdog::reset();
+        throw;
+    }
+    if (CACHE != "") Cache::store(key, options.example, verdict, valuation);
+    return verdict;
+}
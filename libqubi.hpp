@@ -0,0 +1,98 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef LIBQUBI_H
+#define LIBQUBI_H
+
+#include <string>
+#include "circuit.hpp"
+#include "watchdog.hpp"
+#include "checkpoint.hpp"
+
+// The library interface of Qubi, for programs that build their QBFs in
+// memory: create a Circuit with addVar, addBlock, addGate and setOutput,
+// then transform and solve it with a Qubi session, without any I/O (apart
+// from logging, see verbose). The command line tool qubi is a client.
+// Failures are exceptions: Stopped (a full BDD table, see watchdog.hpp)
+// and CheckpointError (-resume).
+//
+// Options holds the configuration, with the same defaults as the command
+// line options (shown in the comments). Internally, the solvers still read
+// the global settings (settings.hpp): each call of a session applies its
+// options to them first.
+
+struct Options {
+    enum Reorder  {none, dfs, matrix, tree};
+    enum Iterate  {left2right, pairwise};
+    enum Order    {inputs, lowpeak};
+    enum Quantify {cube, incremental, adaptive, buckets};
+    enum DontCare {off, restrict, constrain};
+    enum Backend  {sylvanbdd, builtinbdd};
+    enum Engine   {bdd, cegar};
+    enum QBlocks  {keep, split, combine};
+    enum Prefix   {prenex, circuit, miniscope};
+
+    // transformations
+    int quantblocks = keep;         // -q
+    bool flatten    = false;        // -f
+    bool cleanup    = false;        // -c
+    int reorder     = dfs;          // -r
+    int symmetry    = 0;            // -j
+    int prefix      = prenex;       // -x
+    int sweep       = 0;            // -sweep
+
+    // solving
+    bool example    = false;        // -e
+    int iterate     = pairwise;     // -i
+    int order       = inputs;       // -o
+    int quantify    = cube;         // -a
+    int partition   = 0;            // -m
+    int dontcare    = off;          // -d
+    bool garbage    = true;         // -g
+    int budget      = 0;            // -n
+    int approx      = 0;            // -l
+    int zdd         = 0;            // -z
+    int engine      = bdd;          // -y
+    int truthtable  = 20;           // -u
+    std::string checkpoint;         // -checkpoint
+    int period      = 600;          // -period
+    std::string resume;             // -resume
+    std::string dump;               // -dump
+    std::string cache;              // -cache
+
+    // BDD manager, sized when it is opened
+    int backend     = sylvanbdd;    // -b
+    int workers     = 4;            // -w
+    int table       = 29;           // -t
+    size_t memory   = 0;            // -mem, in bytes
+
+    // output
+    bool keepnames  = false;        // -k, for writing QCIR
+    int verbose     = 1;            // -v, log level on stderr
+    bool statistics = false;        // -s
+
+    void apply() const;             // set the global settings
+};
+
+// A session keeps a BDD manager open from the first BDD it needs until it
+// ends, so many circuits can be solved without starting the BDD package
+// again. Changes to the options apply to the next call, except the ones of
+// the BDD manager once it is open.
+// There should be at most one session alive at any moment.
+// This is currently not enforced.
+
+class Qubi {
+    public:
+        Options options;
+
+        Qubi(const Options& options=Options());
+        ~Qubi();
+
+        void transform(Circuit& qbf);                   // before solving or printing
+        bool solve(Circuit& qbf, Valuation& example);   // example only with options.example
+        bool solve(Circuit& qbf) { Valuation _; return solve(qbf, _); }
+        // solve may change the circuit (-z, -n), copy it to keep it;
+        // after Stopped, the session can solve the next circuit
+};
+
+#endif // LIBQUBI_H
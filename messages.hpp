@@ -52,6 +52,14 @@ public:
     }
 };
 
+class ArityError : public QBFexception {
+public:
+    ArityError(string input, int line): QBFexception(input, line) {}
+    string what() {
+        return QBFexception::what() + "Connective \"ite\" expects 3 inputs, but got \"" + input + "\"";
+    }
+};
+
 class ParseError : public QBFexception {
 public:
     ParseError(string input, int line): QBFexception(input, line) {}
@@ -3,54 +3,66 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <cstring>
+#include <optional>
+#include <mutex>
 #include "circuit_rw.hpp"
-#include "solver.hpp"
-#include "bdd_sylvan.hpp"
+#include "messages.hpp"
+#include "libqubi.hpp"
+#include "watchdog.hpp"
 #include "settings.hpp"
 #include "chrono"
 
 using namespace std;
 using namespace chrono;
 
-enum Verbose {quiet, normal, verbose, debug};
-enum Reorder {none, dfs, matrix};
-enum Iterate {left2right, pairwise};
-enum QBlocks {keep, split, combine};
-enum Prefix  {prenex, circuit, miniscope};
-
-constexpr int DEFAULT_VERBOSE = normal;
-constexpr int DEFAULT_REORDER = dfs;
-constexpr int DEFAULT_ITERATE = pairwise;
-constexpr int DEFAULT_QUANTBLOCKS = keep;
-constexpr int DEFAULT_PREFIX = prenex;
-constexpr int DEFAULT_WORKERS = 4;
-constexpr int DEFAULT_TABLE   = 29;
-
-bool EXAMPLE    = false;
+constexpr int DEFAULT_PORTFOLIO = 0;
+constexpr int DEFAULT_CUBES = 0;
+constexpr int DEFAULT_POOL = 4;
+constexpr int DEFAULT_TIMEOUT = 0;
+constexpr int DEFAULT_MEMLIMIT = 0;
+
+Options OPTIONS; // for the library, see libqubi.hpp for the defaults
 bool PRINT      = false;
-bool KEEPNAMES  = false;
-bool GARBAGE    = false;
-bool FLATTEN    = false;
-bool CLEANUP    = false;
-int ITERATE     = DEFAULT_ITERATE;
-int REORDER     = DEFAULT_REORDER;
-int QUANTBLOCKS = DEFAULT_QUANTBLOCKS;
-int PREFIX      = DEFAULT_PREFIX;
-int WORKERS     = DEFAULT_WORKERS;
-int TABLE       = DEFAULT_TABLE;
-int VERBOSE     = DEFAULT_VERBOSE;
-
-bool STATISTICS = false;
-size_t PEAK = 0;
+bool WORKER     = false;
+string BATCH    = "";
+string SOCKET   = "";
+int PORTFOLIO   = DEFAULT_PORTFOLIO;
+int CUBES       = DEFAULT_CUBES;
+int POOL        = DEFAULT_POOL;
+int TIMEOUT     = DEFAULT_TIMEOUT;
+int MEMLIMIT    = DEFAULT_MEMLIMIT;
 
 string NAME; // = "Test/sat13.qcir"; // for debugging
 
+// The configurations of the portfolio (-portfolio=n), on top of the given
+// options. The ones with -x=2 solve most of the instances in TODO.txt.
+const vector<string> CONFIGURATIONS = {
+    "",
+    "-x=2",
+    "-f -x=2",
+    "-q=2 -x=2",
+    "-x=1",
+    "-r=2",
+    "-f",
+    "-q=2",
+};
+
 istream* INFILE;
 
 void usage_short() {
     cout << "Usage:\n"
-         << "solve:\tqubi [-e] [-r=n] [-q=n] [-f] [-c] [-x=n] [-i=n] [-g] [-t=n] [-w=n] [-v=n] [infile]\n"
-         << "print:\tqubi  -p  [-r=n] [-q=n] [-f] [-c] [-x=n] [-k] [-v=n] [infile]\n"
+         << "solve:\tqubi [-e] [-r=n] [-q=n] [-f] [-c] [-x=n] [-j=n] [-i=n] [-o=n] [-a=n] [-m=n] [-d=n] [-g=n] [-n=n] [-l=n] [-z=n] [-y=n] [-u=n] [-b=n] [-t=n] [-mem=n] [-w=n] [-portfolio=n] [-cubes=n] [-pool=n] [-timeout=n] [-memlimit=n] [-checkpoint=file [-period=n]] [-resume=file] [-dump=file] [-cache=dir] [-v=n] [infile]\n"
+         << "jobs :\tqubi  [-worker | -batch=file | -socket=path] [options]\n"
+         << "print:\tqubi  -p  [-r=n] [-q=n] [-f] [-c] [-x=n] [-j=n] [-sweep=n] [-b=n] [-k] [-v=n] [infile]\n"
          << "help :\tqubi  -h"
          << endl;
 }
@@ -64,15 +76,41 @@ void usage() {
          << "\t-e, -example: \t\tsolve and show witness for outermost quantifiers\n"
          << "\t-p, -print: \t\tprint the (transformed) qbf to stdout\n"
          << "\t-k, -keep: \t\tkeep the original gate/var-names (or else: renumber)\n"
+         << "\t-sweep=<n>: \t\tbefore printing, merge equivalent gates, with BDDs up to n nodes per gate (0=off (*))\n"
          << "\t-f, -flatten: \t\tflattening transformation on and/or subcircuits\n"
          << "\t-c, -cleanup: \t\tremove unused variable and gate names\n"
          << "\t-q, -quant=<n>: \tquantifier block transformation: 0=keep (*), 1=split, 2=combine\n"
          << "\t-x, -prefix=<n>: \tmove prefix into circuit: 0=prenex (*), 1=ontop, 2=miniscope\n"
-         << "\t-r, -reorder=<n>: \tvariable reordering: 0=none, 1=dfs (*), 2=matrix\n"
+         << "\t-j, -symmetry=<n>: \tbreak up to n symmetries of the outermost block (0=off (*))\n"
+         << "\t-r, -reorder=<n>: \tvariable reordering: 0=none, 1=dfs (*), 2=matrix, 3=tree decomposition\n"
          << "\t-i, -iterate=<n>: \tevaluate and/or: 0=left-to-right, 1=pairwise (*)\n"
-         << "\t-g, -gc: \t\tswitch on garbage collection (experimental)\n"
+         << "\t-o, -order=<n>: \tevaluation order of gate inputs: 0=as given (*), 1=low peak memory\n"
+         << "\t-a, -abstract=<n>: \tquantify blocks: 0=whole cube (*), 1=one var at a time, 2=adaptive, 3=buckets (with -r=3)\n"
+         << "\t-m, -partition=<n>: \tkeep top-level and/or partitioned, clusters up to n nodes (0=off (*))\n"
+         << "\t-d, -dontcare=<n>: \tsimplify and/or arguments on their siblings: 0=off (*), 1=restrict, 2=constrain\n"
+         << "\t-g, -gc=<n>: \t\tBDD release: 0=keep all gates, 1=at last use (*)\n"
+         << "\t-n, -nodes=<n>: \tBDD budget: expand an inner variable when a BDD exceeds n nodes (0=off (*))\n"
+         << "\t-l, -approx=<n>: \tfirst try to decide on approximations of at most n nodes (0=off (*))\n"
+         << "\t-z, -zdd=<n>: \t\tCNF matrix: resolve inner blocks on ZDD clause sets up to n nodes (0=off (*))\n"
+         << "\t-y, -engine=<n>: \tsolving engine: 0=BDD (*), 1=CEGAR expansion with SAT (prenex only)\n"
+         << "\t-u, -truthtable=<n>: \tno BDDs, use truth tables up to n vars (unless a BDD option is given), n in [0..26], 0=never, 20=(*)\n"
+         << "\t-b, -backend=<n>: \tBDD package: 0=Sylvan (*), 1=built-in (single-threaded, ignores -w)\n"
          << "\t-t, -table=<n>: \tBDD: set max table size to 2^n, n in [15..42], 29=(*)\n"
+         << "\t-mem=<n>: \t\tBDD: size the tables for n GB and the circuit (overrides -t), 0=off (*)\n"
          << "\t-w, -workers=<n>: \tBDD: use n threads, n in [0..64], 0=#cores, 4=(*)\n"
+         << "\t-portfolio=<n>: \trun the first n configurations concurrently, n in [0..8], 0=off (*)\n"
+         << "\t-cubes=<n>: \t\tsplit on n outermost variables, solve the cubes in worker processes, 0=off (*)\n"
+         << "\t-pool=<n>: \t\tnumber of worker processes for -cubes, 4=(*)\n"
+         << "\t-worker: \t\tsolve the jobs on stdin, answer them on stdout (the -cubes protocol)\n"
+         << "\t-batch=<file>: \t\tsolve the QCIR files listed in file, one result line per file\n"
+         << "\t-socket=<path>: \tserve the -worker protocol on a local socket\n"
+         << "\t-timeout=<n>: \t\tstop with UNKNOWN after n seconds (0=off (*))\n"
+         << "\t-memlimit=<n>: \t\tstop with UNKNOWN above n MB resident memory (0=off (*))\n"
+         << "\t-checkpoint=<file>: \tsave the state of the BDD solver in file, periodically\n"
+         << "\t-period=<n>: \t\tseconds between checkpoints, 0=at every step, 600=(*)\n"
+         << "\t-resume=<file>: \tcontinue from a checkpoint (same input and options)\n"
+         << "\t-dump=<file>: \t\twrite the BDD of the matrix after quantifying the prefix\n"
+         << "\t-cache=<dir>: \t\tlook up and store the results in directory dir\n"
          << "\t-v, -verbose=<n>: \tverbose level (0=quiet, 1=normal (*), 2=verbose, 3=debug)\n"
          << "\t-s, -stats: \t\tturn statistics on (leads to slow-down)\n"
          << "\t-h, -help: \t\tthis usage message\n"
@@ -123,20 +161,46 @@ int checkInt(string& arg, string& val, int low, int high) {
 
 bool parseOption(string& arg) {
     string val = getArgument(arg);
-    if (arg == "-example" || arg == "-e") { EXAMPLE = true; return true; }
+    if (arg == "-example" || arg == "-e") { OPTIONS.example = true; return true; }
     if (arg == "-print"   || arg == "-p") { PRINT   = true; return true; }
-    if (arg == "-keep"    || arg == "-k") { KEEPNAMES = true; return true; }
-    if (arg == "-flatten" || arg == "-f") { FLATTEN = true; CLEANUP = true; return true; }
-    if (arg == "-cleanup" || arg == "-c") { CLEANUP = true; return true; }
-    if (arg == "-stats"   || arg == "-s") { STATISTICS = true; return true; }
-    if (arg == "-quant"   || arg == "-q") { QUANTBLOCKS = checkInt(arg,val,0,2); return true; }
-    if (arg == "-prefix"  || arg == "-x") { PREFIX = checkInt(arg,val,0,2); return true; }
-    if (arg == "-iterate" || arg == "-i") { ITERATE = checkInt(arg,val,0,1); return true; }
-    if (arg == "-reorder" || arg == "-r") { REORDER = checkInt(arg,val,0,2); return true; }
-    if (arg == "-gc"      || arg == "-g") { GARBAGE = true; return true; }
-    if (arg == "-verbose" || arg == "-v") { VERBOSE = checkInt(arg,val,0,3); return true; }
-    if (arg == "-workers" || arg == "-w") { WORKERS = checkInt(arg,val,0,64); return true; }
-    if (arg == "-table"   || arg == "-t") { TABLE   = checkInt(arg,val,15,42); return true; }
+    if (arg == "-keep"    || arg == "-k") { OPTIONS.keepnames = true; return true; }
+    if (arg == "-flatten" || arg == "-f") { OPTIONS.flatten = true; OPTIONS.cleanup = true; return true; }
+    if (arg == "-cleanup" || arg == "-c") { OPTIONS.cleanup = true; return true; }
+    if (arg == "-stats"   || arg == "-s") { OPTIONS.statistics = true; return true; }
+    if (arg == "-quant"   || arg == "-q") { OPTIONS.quantblocks = checkInt(arg,val,0,2); return true; }
+    if (arg == "-prefix"  || arg == "-x") { OPTIONS.prefix = checkInt(arg,val,0,2); return true; }
+    if (arg == "-iterate" || arg == "-i") { OPTIONS.iterate = checkInt(arg,val,0,1); return true; }
+    if (arg == "-cubes") { CUBES = checkInt(arg,val,0,20); return true; }
+    if (arg == "-pool") { POOL = checkInt(arg,val,1,256); return true; }
+    if (arg == "-worker") { WORKER = true; return true; }
+    if (arg == "-batch" && val != "") { BATCH = val; return true; }
+    if (arg == "-socket" && val != "") { SOCKET = val; return true; }
+    if (arg == "-timeout") { TIMEOUT = checkInt(arg,val,0,1<<30); return true; }
+    if (arg == "-memlimit") { MEMLIMIT = checkInt(arg,val,0,1<<30); return true; }
+    if (arg == "-checkpoint" && val != "") { OPTIONS.checkpoint = val; return true; }
+    if (arg == "-period") { OPTIONS.period = checkInt(arg,val,0,1<<30); return true; }
+    if (arg == "-resume" && val != "") { OPTIONS.resume = val; return true; }
+    if (arg == "-dump" && val != "") { OPTIONS.dump = val; return true; }
+    if (arg == "-cache" && val != "") { OPTIONS.cache = val; return true; }
+    if (arg == "-portfolio") { PORTFOLIO = checkInt(arg,val,0,CONFIGURATIONS.size()); return true; }
+    if (arg == "-sweep") { OPTIONS.sweep = checkInt(arg,val,0,1<<30); return true; }
+    if (arg == "-symmetry" || arg == "-j") { OPTIONS.symmetry = checkInt(arg,val,0,1<<30); return true; }
+    if (arg == "-reorder" || arg == "-r") { OPTIONS.reorder = checkInt(arg,val,0,3); return true; }
+    if (arg == "-order"   || arg == "-o") { OPTIONS.order = checkInt(arg,val,0,1); return true; }
+    if (arg == "-abstract" || arg == "-a") { OPTIONS.quantify = checkInt(arg,val,0,3); return true; }
+    if (arg == "-partition" || arg == "-m") { OPTIONS.partition = checkInt(arg,val,0,1<<30); return true; }
+    if (arg == "-dontcare" || arg == "-d") { OPTIONS.dontcare = checkInt(arg,val,0,2); return true; }
+    if (arg == "-gc"      || arg == "-g") { OPTIONS.garbage = (val=="" || checkInt(arg,val,0,1)); return true; }
+    if (arg == "-verbose" || arg == "-v") { OPTIONS.verbose = checkInt(arg,val,0,3); return true; }
+    if (arg == "-workers" || arg == "-w") { OPTIONS.workers = checkInt(arg,val,0,64); return true; }
+    if (arg == "-nodes"   || arg == "-n") { OPTIONS.budget = checkInt(arg,val,0,1<<30); return true; }
+    if (arg == "-approx"  || arg == "-l") { OPTIONS.approx = checkInt(arg,val,0,1<<30); return true; }
+    if (arg == "-zdd"     || arg == "-z") { OPTIONS.zdd = checkInt(arg,val,0,1<<30); return true; }
+    if (arg == "-engine"  || arg == "-y") { OPTIONS.engine = checkInt(arg,val,0,1); return true; }
+    if (arg == "-truthtable" || arg == "-u") { OPTIONS.truthtable = checkInt(arg,val,0,26); return true; }
+    if (arg == "-backend" || arg == "-b") { OPTIONS.backend = checkInt(arg,val,0,1); return true; }
+    if (arg == "-table"   || arg == "-t") { OPTIONS.table = checkInt(arg,val,15,42); return true; }
+    if (arg == "-mem") { OPTIONS.memory = (size_t)checkInt(arg,val,0,1<<20) << 30; return true; }
     if (arg == "-help"    || arg == "-h") { usage(); exit(1); }
     return false;
 }
@@ -154,24 +218,61 @@ void parseArgs(int argc, char* argv[]) {
         usage_short(); exit(-1);
     }
 
-    if (EXAMPLE && PRINT) {
+    if (OPTIONS.example && PRINT) {
         LOG(0, "Error: -e(xample) and -p(rint) are inconsistent" << endl);
         usage_short(); exit(-1);
     }
 
-    if (KEEPNAMES && !PRINT) {
+    if (OPTIONS.keepnames && !PRINT) {
         LOG(0, "Error: -k(eep) requires -p(rint)" << endl);
         usage_short(); exit(-1);
     }
 
-    INFILE = openInput(NAME);
+    if ((CUBES>0 || WORKER || BATCH!="" || SOCKET!="") && (PRINT || OPTIONS.example)) {
+        LOG(0, "Error: -cubes, -worker, -batch and -socket are inconsistent with -p(rint) and -e(xample)" << endl);
+        usage_short(); exit(-1);
+    }
 
-    LOG(1, "Reading input from \"" << NAME << "\"" << endl);
+    if ((TIMEOUT>0 || MEMLIMIT>0) && (WORKER || BATCH!="" || SOCKET!="")) {
+        LOG(0, "Error: -timeout and -memlimit are inconsistent with -worker, -batch and -socket" << endl);
+        usage_short(); exit(-1);
+    }
+
+    if ((OPTIONS.checkpoint!="" || OPTIONS.resume!="" || OPTIONS.dump!="") &&
+        (PRINT || OPTIONS.budget>0 || PORTFOLIO>0 || CUBES>0 || WORKER || BATCH!="" || SOCKET!="")) {
+        LOG(0, "Error: -checkpoint, -resume and -dump are inconsistent with -p(rint), -n(odes), -portfolio, -cubes, -worker, -batch and -socket" << endl);
+        usage_short(); exit(-1);
+    }
+
+    if ((OPTIONS.checkpoint!="" || OPTIONS.resume!="" || OPTIONS.dump!="") &&
+        (OPTIONS.partition>0 || OPTIONS.engine==Options::cegar)) {
+        LOG(0, "Error: -checkpoint, -resume and -dump are inconsistent with -m (partitions) and -y=1 (CEGAR)" << endl);
+        usage_short(); exit(-1);
+    }
+
+    if (PORTFOLIO>0 && PRINT) {
+        LOG(0, "Error: -portfolio and -p(rint) are inconsistent" << endl);
+        usage_short(); exit(-1);
+    }
+
+    if (OPTIONS.cache!="" && PRINT) {
+        LOG(0, "Error: -cache and -p(rint) are inconsistent" << endl);
+        usage_short(); exit(-1);
+    }
+
+    if (OPTIONS.sweep>0 && !PRINT) {
+        LOG(0, "Error: -sweep requires -p(rint)" << endl);
+        usage_short(); exit(-1);
+    }
+
+    if (WORKER || BATCH!="" || SOCKET!="") return; // the jobs bring their own input
+
+    INFILE = openInput(NAME);
 }
 
 void report_result(const CircuitRW& qbf, bool verdict, const Valuation& valuation) {
     cout << "Result: " << (verdict ? "TRUE" : "FALSE") << endl;
-    if (EXAMPLE) {
+    if (OPTIONS.example) {
         if (valuation.size() == 0)
             cout << "No example" << endl;
         else {
@@ -181,45 +282,405 @@ void report_result(const CircuitRW& qbf, bool verdict, const Valuation& valuatio
     }
 }
 
-TASK_2(bool, solve_task, CircuitRW*, qbf, Valuation*, valuation) {   
-    Solver solver(*qbf);
-    bool verdict = solver.solve();
-    if (EXAMPLE) *valuation = solver.example();
-    return verdict;
+static vector<pid_t> children; // killed when the parent is interrupted or stopped
+static vector<int> channels;   // the parent's ends of the pipes to the children
+
+void killChildren() {
+    for (pid_t pid : children)
+        if (pid != 0) kill(pid, SIGKILL);
 }
 
-int main(int argc, char *argv[]) {
-    system_clock::time_point starttime = system_clock::now();
-    parseArgs(argc, argv);
-    CircuitRW qbf(*INFILE);
-    if (VERBOSE>=1) qbf.printInfo(cerr);
-    if (QUANTBLOCKS==split) qbf.split();
-    if (QUANTBLOCKS==combine) qbf.combine();
-    if (FLATTEN) qbf.flatten();
-    if (CLEANUP) qbf.cleanup();
-    if (VERBOSE>=1 && (CLEANUP || QUANTBLOCKS>0)) qbf.printInfo(cerr);
-    if (REORDER==dfs) qbf.reorderDfs();
-    if (REORDER==matrix) qbf.reorderMatrix();
-    if (PREFIX>0) {
-        if (PREFIX==circuit) qbf.prefix2circuit();
-        if (PREFIX==miniscope) qbf.miniscope();
-        if (VERBOSE>=1) qbf.printInfo(cerr);
+void interrupted(int signal) {
+    killChildren();
+    _exit(128 + signal);
+}
+
+// After a stop (-timeout, -memlimit, a full BDD table): the result is
+// unknown. Only the first thread reports, the others wait until the exit.
+[[noreturn]] void stopped(const string& report) {
+    static std::mutex stopping;
+    stopping.lock(); // never released
+    killChildren();
+    cout << "Result: UNKNOWN" << endl;
+    LOG(0, report << endl);
+    _exit(0);
+}
+
+// Fork a child process, with pipes to its stdin and from its stdout. The
+// child gets a share (1/n) of the workers and of the BDD table (or budget), and
+// returns 0. The parent returns the pid, and its ends of the pipes.
+pid_t spawn(int n, int& to, int& from) {
+    const int cores = (OPTIONS.workers > 0 ? OPTIONS.workers : std::thread::hardware_concurrency());
+    int shift = 0;
+    while ((1 << shift) < n) shift++;
+    int in[2], out[2];
+    if (pipe(in) != 0 || pipe(out) != 0) { perror("pipe"); exit(-1); }
+    cout.flush(); cerr.flush(); // the child would duplicate buffered output
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); exit(-1); }
+    if (pid == 0) {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        for (int fd : channels) close(fd);
+        dup2(in[0], STDIN_FILENO);
+        dup2(out[1], STDOUT_FILENO);
+        close(in[0]); close(in[1]); close(out[0]); close(out[1]);
+        children.clear();
+        channels.clear();
+        OPTIONS.workers = std::max(1, cores / n);
+        OPTIONS.table = std::max(15, OPTIONS.table - shift);
+        OPTIONS.memory /= n;
+        OPTIONS.verbose = 0;
+        VERBOSE = 0;
+        return 0;
+    }
+    signal(SIGINT, interrupted);
+    signal(SIGTERM, interrupted);
+    signal(SIGPIPE, SIG_IGN); // a failing child is detected by its pipes
+    close(in[0]); close(out[1]);
+    to = in[1];
+    from = out[0];
+    children.push_back(pid);
+    channels.push_back(to);
+    channels.push_back(from);
+    return pid;
+}
+
+// wait for a child that has closed its stdout, returns whether it succeeded
+bool reap(pid_t pid) {
+    int status;
+    waitpid(pid, &status, 0);
+    std::replace(children.begin(), children.end(), pid, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// kill the remaining children, and close all pipes
+void stopChildren() {
+    for (pid_t pid : children)
+        if (pid != 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+    for (int fd : channels) close(fd);
+    children.clear();
+    channels.clear();
+}
+
+void send(int fd, const string& message) {
+    for (size_t done=0; done<message.size(); ) {
+        ssize_t count = write(fd, message.data()+done, message.size()-done);
+        if (count <= 0) { perror("write"); stopChildren(); exit(-1); }
+        done += count;
+    }
+}
+
+// Portfolio: fork a child per configuration, after parsing, so the children
+// share the circuit copy-on-write. Each child writes its result into a pipe.
+// Returns false in the children, which continue with their configuration.
+// The parent copies the first TRUE or FALSE, and kills the other children.
+// A child that stops (e.g. on a full BDD table) reports UNKNOWN: the others
+// go on, and the result is only UNKNOWN if none of them decides.
+bool portfolio(Qubi& qubi, int n) {
+    LOG(1, "Portfolio of " << n << " configurations" << endl);
+    Watchdog::phase("portfolio");
+    vector<pid_t> pids(n);
+    vector<int> pipes(n);
+    for (int i=0; i<n; i++) {
+        int to;
+        pids[i] = spawn(n, to, pipes[i]);
+        if (pids[i] == 0) {
+            std::istringstream options(CONFIGURATIONS[i]);
+            for (string arg; options >> arg; ) parseOption(arg);
+            qubi.options = OPTIONS;
+            return false;
+        }
+        LOG(2, "- child " << pids[i] << ": \"" << CONFIGURATIONS[i] << "\"" << endl);
+    }
+
+    const auto decided = [](const string& result) {
+        return result.rfind("Result: TRUE", 0) == 0 || result.rfind("Result: FALSE", 0) == 0;
+    };
+    vector<string> results(n);
+    int winner = -1, running = n, unknown = 0;
+    while (winner < 0 && running > 0) {
+        vector<pollfd> polls;
+        vector<int> index;
+        for (int i=0; i<n; i++)
+            if (pids[i] != 0) { polls.push_back({pipes[i], POLLIN, 0}); index.push_back(i); }
+        if (poll(polls.data(), polls.size(), -1) < 0) { perror("poll"); exit(-1); }
+        for (size_t k=0; k<polls.size() && winner<0; k++) {
+            if (polls[k].revents == 0) continue;
+            int i = index[k];
+            char buffer[4096];
+            ssize_t count = read(pipes[i], buffer, sizeof(buffer));
+            if (count > 0) { results[i].append(buffer, count); continue; }
+            running--; // end of file: the child has finished
+            bool succeeded = reap(pids[i]);
+            if (succeeded && decided(results[i]))
+                winner = i;
+            else if (succeeded && results[i].rfind("Result: UNKNOWN", 0) == 0) {
+                LOG(1, "- configuration \"" << CONFIGURATIONS[i] << "\" stopped" << endl);
+                unknown++;
+            } else
+                LOG(1, "- configuration \"" << CONFIGURATIONS[i] << "\" failed" << endl);
+            pids[i] = 0;
+        }
+    }
+    stopChildren();
+    if (winner < 0 && unknown > 0)
+        throw Stopped("Stopped (" + to_string(unknown) + " of " + to_string(n) + " configurations UNKNOWN) in phase: portfolio");
+    if (winner < 0) {
+        LOG(0, "Error: no configuration of the portfolio succeeded" << endl);
+        exit(-1);
     }
+    LOG(1, "Solved by configuration \"" << CONFIGURATIONS[winner] << "\"" << endl);
+    cout << results[winner];
+    return true;
+}
+
+// Buffered reading of lines and blocks of bytes from a file descriptor
+struct Channel {
+    int fd;
+    string buffer;
 
-    if (PRINT) {
-        qbf.writeQcir(cout);
-    } else {
-        bool verdict;
-        Valuation valuation;
-        { Sylvan_mgr _(WORKERS, TABLE);
-          verdict = RUN(solve_task, &qbf, &valuation);
-          // Sylvan_mgr is closed automatically
+    bool fill() {
+        char data[4096];
+        ssize_t count = read(fd, data, sizeof(data));
+        if (count <= 0) return false;
+        buffer.append(data, count);
+        return true;
+    }
+    bool line(string& result) {
+        size_t end;
+        while ((end = buffer.find('\n')) == string::npos)
+            if (!fill()) return false;
+        result = buffer.substr(0, end);
+        buffer.erase(0, end+1);
+        return true;
+    }
+    bool bytes(size_t size, string& result) {
+        while (buffer.size() < size)
+            if (!fill()) return false;
+        result = buffer.substr(0, size);
+        buffer.erase(0, size);
+        return true;
+    }
+};
+
+// Parse the input, or report the error and stop
+CircuitRW parse(istream& input) {
+    try {
+        return CircuitRW(input);
+    } catch (QBFexception& err) {
+        cout << err.what() << endl;
+        exit(-1);
+    }
+}
+
+// Solve one job in the session, which keeps its BDD manager open.
+// Returns the verdict and the time spent, as in "TRUE 12 ms", or UNKNOWN.
+string job(Qubi& qubi, istream& qcir) {
+    system_clock::time_point start = system_clock::now();
+    std::optional<CircuitRW> parsed;
+    try {
+        parsed.emplace(qcir);
+    } catch (QBFexception& err) {
+        return "ERROR " + err.what();
+    }
+    CircuitRW& qbf = *parsed;
+    string result;
+    try {
+        qubi.transform(qbf);
+        result = (qubi.solve(qbf) ? "TRUE " : "FALSE ");
+    } catch (const Stopped& stop) { // e.g. a full BDD table: only this job fails
+        LOG(1, stop.what() << endl);
+        result = "UNKNOWN ";
+    }
+    auto timespent = duration_cast<milliseconds>(system_clock::now() - start);
+    return result + to_string(timespent.count()) + " ms";
+}
+
+// Worker (-worker): solve the jobs from in, and answer them on out. A job
+// is a line "job <id> <size>", followed by a QCIR of size bytes. It is
+// answered by a line "<id> TRUE|FALSE|UNKNOWN <time> ms".
+void serve(Qubi& qubi, int in, int out) {
+    Channel channel({in, ""});
+    string header, text;
+    while (channel.line(header)) {
+        std::istringstream words(header);
+        string keyword;
+        int id;
+        size_t size;
+        if (!(words >> keyword >> id >> size) || keyword != "job" || !channel.bytes(size, text)) {
+            LOG(0, "Error: expected a job, but got: \"" << header << "\"" << endl);
+            return;
         }
-        report_result(qbf, verdict, valuation);
+        std::istringstream qcir(text);
+        send(out, to_string(id) + " " + job(qubi, qcir) + "\n");
+    }
+}
+
+// Batch (-batch=file): solve the QCIR files listed in file, one per line
+void batch(Qubi& qubi, const string& list) {
+    std::ifstream names(list);
+    if (names.fail()) {
+        LOG(0, "Could not open file: " << list << endl);
+        exit(-1);
+    }
+    for (string name; getline(names, name); ) {
+        if (name == "") continue;
+        std::ifstream qcir(name);
+        string result = (qcir.fail() ? "ERROR could not open file" : job(qubi, qcir));
+        cout << name << " " << result << endl;
+    }
+}
+
+// Server (-socket=path): serve the worker protocol to one client at a time
+void listen(Qubi& qubi, const string& path) {
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path)-1);
+    unlink(path.c_str());
+    if (server < 0 || bind(server, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(server, 8) != 0) {
+        perror(path.c_str());
+        exit(-1);
     }
+    LOG(1, "Listening on " << path << endl);
+    while (true) {
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0) continue;
+        serve(qubi, client, client);
+        close(client);
+    }
+}
+
+// Cube-and-conquer (-cubes=n): split on the first n variables of the
+// outermost block. The cofactor of cube id (bit k is the value of the k-th
+// variable) is solved as job id by a pool of workers (-pool), which run
+// serve() in child processes. For Exists (Forall), the verdict is true
+// (false) if one cube is; the outstanding jobs are cancelled then. If no
+// cube decides and some are UNKNOWN, so is the verdict.
+bool conquer(Qubi& qubi, const CircuitRW& qbf) {
+    const Block& b = qbf.getBlock(0);
+    const int n = std::min(CUBES, b.size());
+    const int jobs = 1 << n;
+    const int size = std::min(POOL, jobs);
+    const bool decisive = (b.quantifier == Exists); // a cube with this verdict decides
+    LOG(1, "Cube-and-conquer: " << jobs << " cubes on " << size << " workers" << endl);
+    Watchdog::phase("cube-and-conquer");
+    vector<pid_t> pids(size);
+    vector<int> to(size), from(size);
+    for (int w=0; w<size; w++) {
+        pids[w] = spawn(size, to[w], from[w]);
+        if (pids[w] == 0) {
+            qubi.options = OPTIONS;
+            serve(qubi, STDIN_FILENO, STDOUT_FILENO);
+            exit(0);
+        }
+    }
+
+    vector<string> buffers(size);
+    vector<bool> busy(size, false);
+    int next = 0, done = 0, unknown = 0;
+    bool verdict = !decisive;
+    while (done < jobs && verdict != decisive) {
+        for (int w=0; w<size && next<jobs; w++) {
+            if (busy[w]) continue;
+            Valuation cube;
+            for (int k=0; k<n; k++) cube.push_back({b.variables[k], (next >> k) & 1});
+            CircuitRW cofactor(qbf);
+            cofactor.assign(cube);
+            std::ostringstream text;
+            cofactor.writeQcir(text);
+            send(to[w], "job " + to_string(next++) + " " + to_string(text.str().size()) + "\n" + text.str());
+            busy[w] = true;
+        }
+        vector<pollfd> polls;
+        for (int w=0; w<size; w++) polls.push_back({from[w], POLLIN, 0});
+        if (poll(polls.data(), polls.size(), -1) < 0) { perror("poll"); exit(-1); }
+        for (int w=0; w<size; w++) {
+            if (polls[w].revents == 0) continue;
+            char buffer[256];
+            ssize_t count = read(from[w], buffer, sizeof(buffer));
+            if (count <= 0) {
+                LOG(0, "Error: worker " << pids[w] << " failed" << endl);
+                stopChildren();
+                exit(-1);
+            }
+            buffers[w].append(buffer, count);
+            size_t end;
+            while ((end = buffers[w].find('\n')) != string::npos) {
+                std::istringstream answer(buffers[w].substr(0, end));
+                buffers[w].erase(0, end+1);
+                int id;
+                string result;
+                answer >> id >> result;
+                LOG(2, "- cube " << id << ": " << result << endl);
+                if (result != "TRUE" && result != "FALSE" && result != "UNKNOWN") {
+                    LOG(0, "Error: cube " << id << ": " << answer.str() << endl);
+                    stopChildren();
+                    exit(-1);
+                }
+                busy[w] = false;
+                done++;
+                if (result == "UNKNOWN") unknown++;
+                else if ((result == "TRUE") == decisive) verdict = decisive;
+            }
+        }
+    }
+    if (done < jobs) LOG(1, "- decided after " << done << " cubes" << endl);
+    stopChildren();
+    if (verdict != decisive && unknown > 0)
+        throw Stopped("Stopped (" + to_string(unknown) + " of " + to_string(jobs) + " cubes UNKNOWN) in phase: cube-and-conquer");
+    return verdict;
+}
+
+void report_time(system_clock::time_point starttime) {
     auto timespent = duration_cast<milliseconds>(system_clock::now() - starttime);
     LOG(1, "Total time spent: " << timespent.count() << " ms.");
     if (STATISTICS) { LOG(1, " Peak BDD nodes: " << PEAK); }
     LOG(1, std::endl);
+}
+
+int main(int argc, char *argv[]) {
+    system_clock::time_point starttime = system_clock::now();
+    parseArgs(argc, argv);
+    Watchdog::start(TIMEOUT, MEMLIMIT, stopped);
+    try {
+        Qubi qubi(OPTIONS);
+        if (WORKER || BATCH != "" || SOCKET != "") { // the session keeps its BDD manager open
+            if (WORKER) serve(qubi, STDIN_FILENO, STDOUT_FILENO);
+            else if (BATCH != "") batch(qubi, BATCH);
+            else listen(qubi, SOCKET);
+            return 0;
+        }
+        LOG(1, "Reading input from \"" << NAME << "\"" << endl);
+        CircuitRW qbf = parse(*INFILE);
+        if (VERBOSE>=1) qbf.printInfo(cerr);
+        if (PORTFOLIO>0 && portfolio(qubi, PORTFOLIO)) { // a child reported the result
+            report_time(starttime);
+            return 0;
+        }
+
+        if (CUBES>0 && qbf.maxBlock()>0) {
+            report_result(qbf, conquer(qubi, qbf), Valuation());
+        } else if (PRINT) {
+            qubi.transform(qbf); // and sweeping (-sweep)
+            qbf.writeQcir(cout);
+        } else {
+            qubi.transform(qbf);
+            Valuation valuation;
+            bool verdict = qubi.solve(qbf, valuation);
+            report_result(qbf, verdict, valuation);
+        }
+    } catch (const Stopped& stop) {
+        stopped(stop.what());
+    } catch (const CheckpointError& err) {
+        LOG(0, "Error: " << err.what() << endl);
+        exit(-1);
+    }
+    report_time(starttime);
     return 0;
 }
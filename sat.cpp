@@ -0,0 +1,255 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <vector>
+#include <algorithm>
+#include "sat.hpp"
+#include "watchdog.hpp"
+
+int Sat::newVar() {
+    int v = assigns.size();
+    assigns.push_back(0);
+    levels.push_back(0);
+    reasons.push_back(-1);
+    phases.push_back(false);
+    activity.push_back(0);
+    position.push_back(-1);
+    watches.resize(2*v+2);
+    heapInsert(v);
+    return v;
+}
+
+void Sat::addClause(const std::vector<int>& literals) {
+    if (unsat) return;
+    backtrack(0);
+    std::vector<Lit> clause;
+    for (int l : literals) clause.push_back(lit(l));
+    std::sort(clause.begin(), clause.end());
+    clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+    std::vector<Lit> kept;
+    for (size_t i=0; i<clause.size(); i++) {
+        if (i+1<clause.size() && clause[i+1] == (clause[i]^1)) return; // tautology
+        if (val(clause[i]) == 1) return;    // satisfied at level 0
+        if (val(clause[i]) == 0) kept.push_back(clause[i]);
+    }
+    if (kept.size() == 0)
+        unsat = true;
+    else if (kept.size() == 1) {
+        enqueue(kept[0], -1);
+        if (propagate() != -1) unsat = true;
+    } else {
+        clauses.push_back(kept);
+        attach(clauses.size()-1);
+    }
+}
+
+void Sat::attach(int c) {
+    watches[clauses[c][0]].push_back(c);
+    watches[clauses[c][1]].push_back(c);
+}
+
+void Sat::enqueue(Lit p, int reason) {
+    assigns[var(p)] = (p & 1) ? -1 : 1;
+    levels[var(p)] = level();
+    reasons[var(p)] = reason;
+    trail.push_back(p);
+}
+
+// The implied literal of a reason clause is at position 0;
+// the two watched literals are at positions 0 and 1
+int Sat::propagate() {
+    while (qhead < trail.size()) {
+        const Lit falselit = trail[qhead++] ^ 1;
+        std::vector<int>& ws = watches[falselit];
+        size_t i=0, j=0;
+        while (i < ws.size()) {
+            int c = ws[i++];
+            std::vector<Lit>& cl = clauses[c];
+            if (cl[0] == falselit) std::swap(cl[0], cl[1]);
+            if (val(cl[0]) == 1) { ws[j++] = c; continue; }
+            bool moved = false;
+            for (size_t k=2; k<cl.size(); k++) {
+                if (val(cl[k]) != -1) {
+                    std::swap(cl[1], cl[k]);
+                    watches[cl[1]].push_back(c);
+                    moved = true;
+                    break;
+                }
+            }
+            if (moved) continue;
+            ws[j++] = c;
+            if (val(cl[0]) == -1) { // conflict
+                while (i < ws.size()) ws[j++] = ws[i++];
+                ws.resize(j);
+                qhead = trail.size();
+                return c;
+            }
+            enqueue(cl[0], c);
+        }
+        ws.resize(j);
+    }
+    return -1;
+}
+
+// First UIP: resolve the conflict with the reasons on the current level,
+// until a single literal of the current level remains
+void Sat::analyze(int conflict, std::vector<Lit>& learnt, int& backjump) {
+    std::vector<bool> seen(assigns.size(), false);
+    learnt.assign(1, 0);
+    int pending = 0;
+    bool first = true;
+    Lit p = 0;
+    int index = trail.size()-1;
+    int c = conflict;
+    do {
+        const std::vector<Lit>& cl = clauses[c];
+        for (size_t j=(first ? 0 : 1); j<cl.size(); j++) {
+            int v = var(cl[j]);
+            if (seen[v] || levels[v] == 0) continue;
+            seen[v] = true;
+            bump(v);
+            if (levels[v] >= level()) pending++;
+            else learnt.push_back(cl[j]);
+        }
+        first = false;
+        while (!seen[var(trail[index])]) index--;
+        p = trail[index--];
+        c = reasons[var(p)];
+        seen[var(p)] = false;
+        pending--;
+    } while (pending > 0);
+    learnt[0] = p ^ 1;
+
+    backjump = 0;
+    if (learnt.size() > 1) {
+        size_t max = 1;
+        for (size_t j=2; j<learnt.size(); j++)
+            if (levels[var(learnt[j])] > levels[var(learnt[max])]) max = j;
+        std::swap(learnt[1], learnt[max]);
+        backjump = levels[var(learnt[1])];
+    }
+}
+
+void Sat::backtrack(int lvl) {
+    if (level() <= lvl) return;
+    for (size_t i=trail.size(); i-- > limits[lvl]; ) {
+        int v = var(trail[i]);
+        phases[v] = (assigns[v] > 0);
+        assigns[v] = 0;
+        reasons[v] = -1;
+        if (position[v] < 0) heapInsert(v);
+    }
+    trail.resize(limits[lvl]);
+    limits.resize(lvl);
+    qhead = trail.size();
+}
+
+static double luby(int i) { // 1,1,2,1,1,2,4,1,1,2,...
+    int size = 1, seq = 0;
+    while (size < i+1) { seq++; size = 2*size+1; }
+    while (size-1 != i) { size = (size-1)/2; seq--; i = i % size; }
+    double result = 1;
+    while (seq-- > 0) result *= 2;
+    return result;
+}
+
+bool Sat::solve() {
+    if (unsat) return false;
+    backtrack(0);
+    if (propagate() != -1) { unsat = true; return false; }
+    int restarts = 0;
+    size_t conflicts = 0;
+    size_t limit = 100 * luby(restarts);
+    std::vector<Lit> learnt;
+    while (true) {
+        int conflict = propagate();
+        if (conflict != -1) {
+            conflicts++;
+            if (level() == 0) { unsat = true; return false; }
+            int backjump;
+            analyze(conflict, learnt, backjump);
+            backtrack(backjump);
+            if (learnt.size() == 1)
+                enqueue(learnt[0], -1);
+            else {
+                clauses.push_back(learnt);
+                attach(clauses.size()-1);
+                enqueue(learnt[0], clauses.size()-1);
+            }
+            increment /= 0.95;
+        } else if (conflicts >= limit) {
+            Watchdog::check();
+            backtrack(0);
+            conflicts = 0;
+            limit = 100 * luby(++restarts);
+        } else {
+            int v = 0;
+            while (heap.size() > 0 && v == 0) {
+                v = heapPop();
+                if (assigns[v] != 0) v = 0;
+            }
+            if (v == 0) { // all variables assigned
+                model.assign(assigns.size(), false);
+                for (size_t w=1; w<assigns.size(); w++) model[w] = (assigns[w] > 0);
+                backtrack(0);
+                return true;
+            }
+            limits.push_back(trail.size());
+            enqueue(phases[v] ? 2*v : 2*v+1, -1);
+        }
+    }
+}
+
+/* activity heap */
+
+void Sat::bump(int v) {
+    activity[v] += increment;
+    if (activity[v] > 1e100) {
+        for (double& a : activity) a *= 1e-100;
+        increment *= 1e-100;
+    }
+    if (position[v] >= 0) heapUp(position[v]);
+}
+
+void Sat::heapUp(int i) {
+    int v = heap[i];
+    while (i > 0 && activity[heap[(i-1)/2]] < activity[v]) {
+        heap[i] = heap[(i-1)/2];
+        position[heap[i]] = i;
+        i = (i-1)/2;
+    }
+    heap[i] = v;
+    position[v] = i;
+}
+
+void Sat::heapDown(int i) {
+    int v = heap[i];
+    int n = heap.size();
+    while (2*i+1 < n) {
+        int child = 2*i+1;
+        if (child+1 < n && activity[heap[child+1]] > activity[heap[child]]) child++;
+        if (activity[heap[child]] <= activity[v]) break;
+        heap[i] = heap[child];
+        position[heap[i]] = i;
+        i = child;
+    }
+    heap[i] = v;
+    position[v] = i;
+}
+
+void Sat::heapInsert(int v) {
+    heap.push_back(v);
+    heapUp(heap.size()-1);
+}
+
+int Sat::heapPop() {
+    int v = heap[0];
+    position[v] = -1;
+    heap[0] = heap.back();
+    heap.pop_back();
+    if (heap.size() > 0) {
+        position[heap[0]] = 0;
+        heapDown(0);
+    }
+    return v;
+}
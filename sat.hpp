@@ -0,0 +1,61 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef SAT_H
+#define SAT_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class Sat {
+
+// A small CDCL SAT solver: two watched literals, first-UIP learning,
+// activity-based decisions with phase saving, and Luby restarts.
+// Variables are 1..n, a literal is a variable or its negation (as in DIMACS).
+// Clauses can be added between calls to solve() (incremental use).
+
+public:
+    int newVar();
+    int maxVar() const                  { return assigns.size()-1; }
+    void addClause(const std::vector<int>& literals);
+    bool solve();                       // satisfiable?
+    bool value(int var) const           { return model.at(var); } // after solve() returned true
+
+private:
+    typedef uint32_t Lit;               // 2*var (+1 for negation)
+    static Lit lit(int l)               { return l > 0 ? 2*l : 2*(-l)+1; }
+    static int var(Lit p)               { return p >> 1; }
+
+    std::vector<std::vector<Lit>> clauses;  // original and learnt clauses
+    std::vector<std::vector<int>> watches;  // per literal: clauses watching it
+    std::vector<int8_t> assigns = {0};      // per variable: 0=unassigned, 1=true, -1=false
+    std::vector<int> levels = {0};          // decision level of each variable
+    std::vector<int> reasons = {-1};        // implying clause of each variable (-1=decision)
+    std::vector<bool> phases = {false};     // last value of each variable
+    std::vector<Lit> trail;
+    std::vector<size_t> limits;             // trail size at the start of each level
+    size_t qhead = 0;                       // next trail position to propagate
+    bool unsat = false;                     // conflict at level 0
+    std::vector<bool> model;
+
+    std::vector<double> activity = {0};
+    double increment = 1;
+    std::vector<int> heap;                  // binary max-heap of variables on activity
+    std::vector<int> position = {-1};       // index of each variable in heap (-1=absent)
+
+    int val(Lit p) const                { int8_t a = assigns[var(p)]; return (p & 1) ? -a : a; }
+    int level() const                   { return limits.size(); }
+    void enqueue(Lit p, int reason);
+    int propagate();                    // returns conflicting clause, or -1
+    void analyze(int conflict, std::vector<Lit>& learnt, int& backjump);
+    void backtrack(int level);
+    void attach(int c);
+    void bump(int v);
+    void heapUp(int i);
+    void heapDown(int i);
+    void heapInsert(int v);
+    int heapPop();
+};
+
+#endif // SAT_H
@@ -5,13 +5,26 @@
 #define SETTINGS_H
 
 #include <iostream>
+#include <string>
 
-// global variables, defined in main program qubi.cpp
+// global variables, defined in libqubi.cpp and set by Options::apply()
 
 extern int VERBOSE;
 extern int ITERATE;
+extern int PARTITION;
+extern int DONTCARE;
+extern int ORDER;
+extern int QUANTIFY;
+extern int ZDD;
+extern int BUDGET;
+extern int APPROX;
 extern bool KEEPNAMES;
 extern bool GARBAGE;
+extern std::string CHECKPOINT;
+extern std::string RESUME;
+extern std::string DUMP;
+extern std::string CACHE;
+extern int PERIOD;
 
 #define LOG(level, msg) { if (level<=VERBOSE) {std::cerr << msg; }}
 
@@ -4,26 +4,175 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cassert>
+#include <set>
+#include <map>
+#include <chrono>
+#include <fstream>
 #include "solver.hpp"
+#include "bdd_sylvan.hpp"
+#include "bdd_builtin.hpp"
+#include "watchdog.hpp"
 #include "settings.hpp"
 
 using std::cout;
 using std::cerr;
 using std::endl;
 
-Solver::Solver(const Circuit& circuit) : c(circuit), matrix(false) { }
+template <class BDD>
+Solver<BDD>::Solver(const Circuit& circuit) : c(circuit), matrix(false) { }
 
-bool Solver::solve() {
-    matrix2bdd();
-    prefix2bdd();
+template <class BDD>
+bool Solver<BDD>::solve() {
+    resumed = Checkpoint::open(c);
+    if (APPROX > 0 && resumed == Checkpoint::none && approximate()) return verdict();
+    if (PARTITION > 0) {
+        matrix2partitions();
+        if (overbudget) return false;
+        if (GARBAGE) BDD::gc(); // the intermediate gate BDDs are dropped
+        prefix2partitions();
+    } else {
+        if (resumed != Checkpoint::blocks) matrix2bdd();
+        if (overbudget) return false;
+        if (GARBAGE) BDD::gc(); // the intermediate gate BDDs are dropped
+        prefix2bdd();
+    }
+    if (overbudget) return false;
+    if (DUMP != "") dump();
     return verdict();
 }
 
+// The matrix after quantifying the prefix, in the format of Bdd_base::Write
+template <class BDD>
+void Solver<BDD>::dump() const {
+    std::ofstream file(DUMP, std::ios::binary);
+    BDD::Write(file, {matrix});
+    if (file.fail())
+        LOG(0, "Warning: could not write \"" << DUMP << "\"" << endl)
+    else
+        LOG(1, "Wrote the matrix BDD to \"" << DUMP << "\"" << endl);
+}
+
+// Give up when a BDD grows beyond BUDGET nodes (0=no budget)
+template <class BDD>
+bool Solver<BDD>::overBudget(const BDD& bdd) {
+    if (BUDGET > 0 && !overbudget && bdd.NodeCount() > (size_t)BUDGET) {
+        LOG(1," [exceeds budget of " << BUDGET << " nodes]" << endl);
+        overbudget = true;
+    }
+    return overbudget;
+}
+
+// Evaluate the cone of the output on pairs of over- and under-approximations
+// of at most APPROX nodes, and quantify the prefix on both of them.
+// A QBF is monotone in its matrix: it is false if it is false on the
+// over-approximation, and true if it is true on the under-approximation.
+// Then the matrix is set to that approximation, which also yields an example.
+
+template <class BDD>
+bool Solver<BDD>::approximate() {
+    LOG(1,"Approximating Matrix (" << APPROX << " nodes)" << endl);
+    Watchdog::phase("approximating the matrix", "gate");
+    auto start = std::chrono::steady_clock::now();
+    const int first = c.maxVar();
+    const int out = abs(c.getOutput());
+    std::map<int,pair<BDD,BDD>> approx;    // (over, under) of the live gates
+    auto lookup = [&](int lit)->pair<BDD,BDD> {
+        int i = abs(lit);
+        pair<BDD,BDD> p = (i < first ? pair<BDD,BDD>(BDD(i), BDD(i)) : approx.at(i));
+        return (lit > 0 ? p : pair<BDD,BDD>(!p.second, !p.first));
+    };
+
+    const auto mux = [](BDD a, const BDD& b, const BDD& notA, const BDD& c) { // (a /\ b) \/ (notA /\ c)
+        BDD rest(notA);
+        a *= b; rest *= c; a += rest;
+        return a;
+    };
+
+    vector<int> uses(std::max(out,first)+1, 0); // number of pending users of each gate
+    uses[out] = 1;
+    for (int i=out; i>=first; i--) {
+        if (uses[i]==0) continue;
+        for (int arg: c.getGate(i).inputs) uses[abs(arg)]++;
+    }
+    for (int i=first; i<=out; i++) {
+        if (uses[i]==0) continue;
+        const Gate& g = c.getGate(i);
+        BDD over(g.output==And), under(g.output==And);
+        if (g.output == And || g.output == Or) {
+            for (int arg : g.inputs) {
+                pair<BDD,BDD> p = lookup(arg);
+                if (g.output == And) { over *= p.first; under *= p.second; }
+                else                 { over += p.first; under += p.second; }
+                over = over.OverApprox(APPROX);
+                under = under.UnderApprox(APPROX);
+            }
+        }
+        else if (g.output == Xor) { // a ^ b = (a /\ !b) \/ (!a /\ b)
+            for (int arg : g.inputs) {
+                pair<BDD,BDD> p = lookup(arg);
+                BDD o = mux(over, !p.second, !under, p.first);
+                BDD u = mux(under, !p.first, !over, p.second);
+                over = o.OverApprox(APPROX);
+                under = u.UnderApprox(APPROX);
+            }
+        }
+        else if (g.output == Ite) {
+            pair<BDD,BDD> a = lookup(g.inputs[0]), t = lookup(g.inputs[1]), e = lookup(g.inputs[2]);
+            over = mux(a.first, t.first, !a.second, e.first).OverApprox(APPROX);
+            under = mux(a.second, t.second, !a.first, e.second).UnderApprox(APPROX);
+        }
+        else if (g.output == Ex || g.output == All) {
+            pair<BDD,BDD> p = lookup(g.inputs[0]);
+            over = (g.output == Ex ? p.first.ExistAbstract(g.quants) : p.first.UnivAbstract(g.quants));
+            under = (g.output == Ex ? p.second.ExistAbstract(g.quants) : p.second.UnivAbstract(g.quants));
+            over = over.OverApprox(APPROX);
+            under = under.UnderApprox(APPROX);
+        }
+        else assert(false);
+        for (int arg : g.inputs)
+            if (abs(arg) >= first && --uses[abs(arg)] == 0) approx.erase(abs(arg));
+        approx.emplace(i, pair<BDD,BDD>(over, under));
+        Watchdog::check(i);
+    }
+    auto [over, under] = lookup(c.getOutput());
+    approx.clear();
+
+    Watchdog::phase("approximating the prefix", "block");
+    for (int i=c.maxBlock()-1; i>0; i--) { // quantify blocks from last to second
+        Watchdog::check(i+1);
+        Block b = c.getBlock(i);
+        if (b.quantifier == Forall) {
+            over = over.UnivAbstract(b.variables).OverApprox(APPROX);
+            under = under.UnivAbstract(b.variables).UnderApprox(APPROX);
+        } else {
+            over = over.ExistAbstract(b.variables).OverApprox(APPROX);
+            under = under.ExistAbstract(b.variables).UnderApprox(APPROX);
+        }
+    }
+    auto time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    matrix = over;
+    if (!verdict()) {
+        LOG(1,"- decided on over-approximation in " << time.count() << " ms" << endl);
+        return true;
+    }
+    matrix = under;
+    if (verdict()) {
+        LOG(1,"- decided on under-approximation in " << time.count() << " ms" << endl);
+        return true;
+    }
+    LOG(1,"- approximation inconclusive after " << time.count() << " ms" << endl);
+    if (GARBAGE) BDD::gc();
+    return false;
+}
+
 // Here we assume that either the matrix is a leaf, or all variables 
 // except for the first (outermost) block have been eliminated
-bool Solver::verdict() const {
+template <class BDD>
+bool Solver<BDD>::verdict() const {
     if (matrix.isConstant()) {
-        return matrix == Sylvan_Bdd(true);
+        return matrix == BDD(true);
     }
     else { // there must be at least one variable
         return (c.getBlock(0).quantifier == Exists);
@@ -32,7 +181,8 @@ bool Solver::verdict() const {
 
 // Here we assume that either the matrix is a leaf, or all variables 
 // except for the first (outermost) block have been eliminated
-Valuation Solver::example() const {
+template <class BDD>
+Valuation Solver<BDD>::example() const {
     Valuation valuation;
     if (c.maxBlock() == 0 ||
         verdict() != (c.getBlock(0).quantifier == Exists)) {
@@ -46,7 +196,7 @@ Valuation Solver::example() const {
             if (b.quantifier != q) break; // stop at first quantifier alternation
             for (int v : b.variables) vars.push_back(v);
         }
-        // let Sylvan compute a valuation
+        // let the BDD package compute a valuation
         vector<bool> val;
         if (q==Exists)
             val = matrix.PickOneCube(vars);
@@ -59,82 +209,383 @@ Valuation Solver::example() const {
     }
 }
 
-// compute the last use of each bdd and store in cleanup
+// Compute an order of the inputs of each gate with a low peak of live BDDs.
+// Bottom-up, each gate gets an estimated BDD size (est), and the peak size
+// needed to evaluate it as a tree (need). As in Sethi-Ullman labelling, the
+// inputs are evaluated in decreasing order of need-est. Shared gates are
+// handled greedily by simulating the DFS of gates2bdd: inputs that are
+// already evaluated come first; they cost nothing and may short-cut the gate.
 
-void Solver::computeCleanup() {
-        std::set<int> cleaned;
-        for (int i=c.maxVar(); i<=abs(c.getOutput()); i++) {
-            cleanup.push_back(std::set<int>());
+template <class BDD>
+void Solver<BDD>::computeSchedule(const vector<int>& roots) {
+    LOG(1,"Scheduling Gates (low peak memory)" << endl);
+    const int first = c.maxVar();
+    int out = first-1;
+    for (int root : roots) out = std::max(out, abs(root));
+    const long long CAP = 1LL << 40;            // keep the estimates finite
+    vector<long long> est(out+1, 1), need(out+1, 1);
+    const auto before = [&](int a, int b) {     // evaluate a before b
+        return need[a]-est[a] > need[b]-est[b];
+    };
+    for (int i=first; i<=out; i++) {
+        const Gate& g = c.getGate(i);
+        vector<int> args;
+        for (int arg : g.inputs) args.push_back(abs(arg));
+        std::stable_sort(args.begin(), args.end(), before);
+        long long held=0, peak=0;
+        for (int arg : args) {
+            peak = std::max(peak, held + need[arg]);
+            held = std::min(held + est[arg], CAP);
         }
+        est[i] = ((g.output == Ex || g.output == All) && args.size()>0 ? est[args[0]] : std::max(held, 1LL));
+        need[i] = std::max(peak, held + est[i]);
+    }
 
-        for (int i=abs(c.getOutput()); i>=c.maxVar(); i--) {
-            Gate g = c.getGate(i);
-            for (int arg: g.inputs) {
-                arg = abs(arg);
-                if (arg>=c.maxVar() && cleaned.count(arg)==0) { //this is the last time arg is going to be used
-                    cleanup[i-c.maxVar()].insert(arg);
-                    cleaned.insert(arg);
-                }
-            }
-        }
+    schedule.assign(out+1-first, vector<int>());
+    vector<bool> done(out+1, false);
+    vector<pair<int,bool>> todo;                // (gate, inputs visited)
+    for (int i=(int)roots.size()-1; i>=0; i--) todo.push_back({abs(roots[i]), false});
+    while (todo.size()!=0) {
+        auto [i, visited] = todo.back(); todo.pop_back();
+        if (i<first || done[i]) continue;
+        if (visited) { done[i] = true; continue; }
+        vector<int>& order = schedule[i-first];
+        if (order.size()>0) continue;           // already on the stack
+        order = c.getGate(i).inputs;
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            a = abs(a); b = abs(b);
+            if (done[a] || done[b] || a<first || b<first)
+                return (done[a] || a<first) && !(done[b] || b<first);
+            return before(a,b);
+        });
+        todo.push_back({i, true});
+        for (int j=order.size()-1; j>=0; j--) todo.push_back({abs(order[j]), false});
+    }
+    for (int root : roots)
+        LOG(2,"- estimated peak for " << c.varString(root) << ": " << need[abs(root)] << endl);
 }
 
+template <class BDD>
+void Solver<BDD>::matrix2bdd() {
+    LOG(1,"Building BDD for Matrix" << endl;);
+    Watchdog::phase("building the matrix", "gate");
+    vector<BDD> result = gates2bdd({c.getOutput()});
+    if (!overbudget) matrix = result[0];
+}
 
-void Solver::matrix2bdd() {
-    vector<Sylvan_Bdd> bdds({Sylvan_Bdd(false)}); // lookup table previous BDDs, start at 1
-    auto toBdd = [&bdds](int i)->Sylvan_Bdd {     // negate (if necessary) and look up Bdd
+// Build the BDDs for the gates in the cone of the roots, on demand.
+// Gates are built in DFS post-order from the roots, which is a topological
+// order of the live cone; unreachable gates are never built.
+// And/Or gates stop as soon as the arguments so far reach their absorbing
+// element (false/true). Left-to-right (-i=0) keeps a running fold; pairwise
+// (-i=1) folds in the same balanced tree as bigAnd/bigOr, but incrementally:
+// two groups of equal size are combined as soon as both are complete. The
+// running fold is then held by at most log(n) groups (a single one after
+// 2^k arguments), and the gate stops when any group reaches that element.
+// Xor gates are folded left-to-right, and the inputs of Ite keep their order.
+// Their remaining arguments are then released, and only built if another
+// gate still needs them.
+
+template <class BDD>
+vector<BDD> Solver<BDD>::gates2bdd(const vector<int>& roots) {
+    const int first = c.maxVar();
+    int out = first-1;                          // the highest root
+    for (int root : roots) out = std::max(out, abs(root));
+    vector<BDD> bdds(out+1, BDD(false)); // lookup table previous BDDs, start at 1
+    vector<bool> built(bdds.size(), false);
+    vector<int> uses(bdds.size(), 0);           // number of pending users of each gate
+    auto toBdd = [&bdds](int i)->BDD {   // negate (if necessary) and look up Bdd
         if (i>0)
             return bdds[i];
         else
             return !bdds[-i];
     };
-    for (int i=1; i<c.maxVar(); i++) {
-        bdds.push_back(Sylvan_Bdd(i));
+    for (int i=1; i<first; i++) {
+        bdds[i] = BDD(i);
+        built[i] = true;
     }
-    LOG(1,"Building BDD for Matrix" << endl;);
-    if (GARBAGE) computeCleanup();
-    for (int i=c.maxVar(); i<=abs(c.getOutput()); i++) {
-        LOG(2,"- gate " << c.varString(i) << ": ");
-        Gate g = c.getGate(i);
-        if (g.quants.size()==0)
-            LOG(2, Ctext[g.output] << "(" << g.inputs.size() << ")")
-        else
-            LOG(2, Ctext[g.output] << "(" << g.quants.size() << "x)")
-        vector<Sylvan_Bdd> args;
-        for (int arg: g.inputs) args.push_back(toBdd(arg));
-
-        if (GARBAGE) {
-            set<int> garbage = cleanup[i-c.maxVar()];
-            if (garbage.size()>0) LOG(3, " [garbage:");
-            for (int j : garbage) { // Do the cleanup
-                bdds[j] = Sylvan_Bdd(false);
-                LOG(3, " " << c.varString(j))
+
+    // count the users of each gate in the cone of the roots (inputs precede gates)
+    int cone = 0;
+    for (int root : roots) uses[abs(root)]++;   // the roots are used by the prefix
+    for (int i=out; i>=first; i--) {
+        if (uses[i]==0) continue;               // gate not reachable from the output
+        cone++;
+        for (int arg: c.getGate(i).inputs) uses[abs(arg)]++;
+    }
+
+    // drop one use of gate i. When no users remain, either free its BDD (-g=1),
+    // or, if it was never built, release its own inputs as well
+    int skipped = 0;
+    int alive = 0, peakalive = 0;               // number of gate BDDs held in bdds
+    vector<int> garbage;                        // freed since the last gate was reported
+    auto release = [&](int i) {
+        vector<int> todo({i});
+        while (todo.size()!=0) {
+            int j = todo.back(); todo.pop_back();
+            if (j<first || --uses[j]>0) continue;
+            if (built[j]) {
+                if (GARBAGE) {
+                    bdds[j] = BDD(false);
+                    garbage.push_back(j);
+                    alive--;
+                }
+            } else {
+                skipped++;
+                for (int arg: c.getGate(j).inputs) todo.push_back(abs(arg));
             }
-            if (garbage.size()>0) LOG(3,"]");
-        }
-
-        Sylvan_Bdd bdd(false);
-        if (g.output == And)
-            bdd = Sylvan_Bdd::bigAnd(args);
-        else if (g.output == Or)
-            bdd = Sylvan_Bdd::bigOr(args);
-        else if (g.output == Ex)
-            bdd = args[0].ExistAbstract(g.quants);
-        else if (g.output == All)
-            bdd = args[0].UnivAbstract(g.quants);
-        else
-            assert(false);
-        if (STATISTICS) { LOG(2," (" << bdd.NodeCount() << " nodes)"); }
-        LOG(2, endl);
-        bdds.push_back(bdd);
+        }
+    };
+
+    // simplify a new argument of and (or) on the don't-cares of its last
+    // siblings: where a sibling is false (true), the gate doesn't depend on it
+    int minimized = 0;
+    auto minimize = [&minimized](const BDD& bdd, const vector<BDD>& siblings, bool conj)->BDD {
+        BDD result = bdd;
+        for (size_t k=0; k<std::min(siblings.size(), CANDIDATES); k++) {
+            const BDD& sibling = siblings[siblings.size()-1-k];
+            result = result.Minimize(conj ? sibling : !sibling);
+        }
+        if (!(result == bdd)) minimized++;
+        return result;
+    };
+
+    // a frame is a gate under construction: inputs[0..next) have been consumed.
+    // Ex over And (All over Or) is fused into an and-exists over the inputs of
+    // the And (the negated inputs of the Or), if the And/Or has no other users.
+    struct Frame {
+        int gate;
+        vector<int> inputs;
+        size_t next;
+        BDD acc;             // running fold (left-to-right)
+        vector<BDD> args;    // collected arguments (pairwise, quantifiers)
+        bool done;                  // reached absorbing element (fold or argument)
+        int fused;                  // the And/Or gate fused into this quantifier
+    };
+    if (ORDER) computeSchedule(roots);
+    auto inputs = [&](int i)->const vector<int>& { // in scheduled order (-o=1)
+        if (ORDER && schedule[i-first].size()>0)
+            return schedule[i-first];
+        return c.getGate(i).inputs;
+    };
+    auto frame = [&](int i)->Frame {
+        const Gate& g = c.getGate(i);
+        Frame f({i, g.output==Ite ? g.inputs : inputs(i), 0, BDD(g.output==And), vector<BDD>(), false, 0});
+        if (g.output == Ex || g.output == All) {
+            int lit = g.inputs[0];
+            int child = abs(lit);
+            if (child >= first && !built[child] && uses[child]==1) {
+                Connective conn = c.getGate(child).output;
+                if ((conn == And || conn == Or) && (g.output==Ex) == ((lit>0) == (conn==And))) {
+                    f.fused = child;
+                    f.inputs = inputs(child);
+                    if (conn == Or)
+                        for (int& arg : f.inputs) arg = -arg;
+                    uses[child] = 0; // its inputs are consumed by this frame instead
+                }
+            }
+        }
+        return f;
+    };
+
+    // A checkpoint (-checkpoint) holds the built gates, the pending uses, the
+    // live gate BDDs, and the frames under construction with their BDDs
+    vector<Frame> stack;
+    auto save = [&]() {
+        std::ostream& file = Checkpoint::create(c, Checkpoint::gates);
+        vector<int> made, live, frames;
+        vector<BDD> saved;
+        for (int i=first; i<=out; i++) {
+            if (built[i]) made.push_back(i);
+            if (built[i] && uses[i]>0) { live.push_back(i); saved.push_back(bdds[i]); }
+        }
+        for (const Frame& f : stack) {
+            frames.insert(frames.end(), {f.gate, f.fused, (int)f.next, f.done, (int)f.inputs.size(), (int)f.args.size()});
+            frames.insert(frames.end(), f.inputs.begin(), f.inputs.end());
+            saved.push_back(f.acc);
+            saved.insert(saved.end(), f.args.begin(), f.args.end());
+        }
+        Checkpoint::writeInts(file, roots);
+        Checkpoint::writeInts(file, made);
+        Checkpoint::writeInts(file, live);
+        Checkpoint::writeInts(file, vector<int>(uses.begin()+first, uses.end()));
+        Checkpoint::writeInts(file, {skipped, peakalive, minimized});
+        Checkpoint::writeInts(file, frames);
+        BDD::Write(file, saved);
+        Checkpoint::commit();
+    };
+    auto restore = [&]() {
+        std::istream& file = Checkpoint::input();
+        if (Checkpoint::readInts(file) != roots) Checkpoint::damaged();
+        vector<int> made = Checkpoint::readInts(file);
+        vector<int> live = Checkpoint::readInts(file);
+        vector<int> pending = Checkpoint::readInts(file);
+        vector<int> counts = Checkpoint::readInts(file);
+        vector<int> frames = Checkpoint::readInts(file);
+        vector<BDD> saved;
+        if (!BDD::Read(file, saved) || pending.size() != uses.size()-first || counts.size() != 3)
+            Checkpoint::damaged();
+        for (int i : made) built.at(i) = true;
+        std::copy(pending.begin(), pending.end(), uses.begin()+first);
+        skipped = counts[0]; peakalive = counts[1]; minimized = counts[2];
+        size_t k = 0;
+        for (int i : live) bdds.at(i) = saved.at(k++);
+        alive = live.size();
+        for (size_t j=0; j<frames.size(); ) {
+            const int* x = &frames.at(j+5);
+            Frame f({frames[j], vector<int>(x+1, x+1+frames[j+4]), (size_t)frames[j+2], saved.at(k++),
+                     vector<BDD>(), (bool)frames[j+3], frames[j+1]});
+            for (int a=0; a<frames[j+5]; a++) f.args.push_back(saved.at(k++));
+            stack.push_back(f);
+            j += 6 + frames[j+4];
+        }
+        Checkpoint::close();
+        LOG(1, "- resumed with " << made.size() << " gates built, " << stack.size() << " under construction" << endl);
+    };
+
+    auto build = [&]() {
+        while (stack.size()!=0) {
+            Frame& f = stack.back();
+            const Gate& g = c.getGate(f.gate);
+
+            if (!f.done && f.next < f.inputs.size()) {  // consume the next argument
+                int arg = f.inputs[f.next];
+                if (!built[abs(arg)]) {                 // demand it first
+                    stack.push_back(frame(abs(arg)));   // invalidates f
+                    continue;
+                }
+                BDD bdd = toBdd(arg);
+                f.next++;
+                release(abs(arg));
+                if (f.fused) {
+                    if (DONTCARE) bdd = minimize(bdd, f.args, true);
+                    f.args.push_back(bdd);
+                    f.done = (bdd == BDD(false));
+                }
+                else if (g.output == And || g.output == Or) {
+                    const BDD absorbing(g.output == Or);
+                    if (ITERATE == 0) {
+                        if (DONTCARE) bdd = minimize(bdd, {f.acc}, g.output == And);
+                        if (g.output == And) f.acc *= bdd; else f.acc += bdd;
+                        f.done = (f.acc == absorbing);
+                    } else {
+                        if (DONTCARE) bdd = minimize(bdd, f.args, g.output == And);
+                        f.args.push_back(bdd);
+                        f.done = (bdd == absorbing);
+                        for (size_t k=f.next; !f.done && k%2==0; k/=2) { // k-th argument: ctz(k) merges
+                            BDD group = f.args.back();
+                            f.args.pop_back();
+                            if (g.output == And) f.args.back() *= group; else f.args.back() += group;
+                            f.done = (f.args.back() == absorbing);
+                        }
+                    }
+                }
+                else if (g.output == Xor)
+                    f.acc ^= bdd;
+                else f.args.push_back(bdd);
+                continue;
+            }
+
+            // all arguments are available, or the gate is decided
+            LOG(2,"- gate " << c.varString(f.gate) << ": ");
+            if (g.quants.size()==0)
+                LOG(2, Ctext[g.output] << "(" << g.inputs.size() << ")")
+            else
+                LOG(2, Ctext[g.output] << "(" << g.quants.size() << "x)")
+            if (f.fused)
+                LOG(2, " [and-exists over " << c.varString(f.fused) << ": "
+                    << Ctext[c.getGate(f.fused).output] << "(" << f.inputs.size() << ")]");
+            if (f.done && f.next < f.inputs.size())
+                LOG(2, " (short-cut after " << f.next << ")");
+            for (size_t j=f.next; j<f.inputs.size(); j++) // release unconsumed arguments
+                release(abs(f.inputs[j]));
+            if (garbage.size()>0) {
+                LOG(3, " [garbage:");
+                for (int j : garbage) LOG(3, " " << c.varString(j));
+                LOG(3,"]");
+                garbage.clear();
+            }
+
+            BDD bdd(false);
+            if (f.fused) {  // Ex xs (/\ args) or All xs (\/ args) = !Ex xs (/\ !args)
+                if (!f.done)
+                    bdd = BDD::bigAndExists(f.args, g.quants);
+                if (g.output == All)
+                    bdd = !bdd;
+            }
+            else if ((g.output == And || g.output == Or) && (f.done || ITERATE == 0))
+                bdd = (f.done ? BDD(g.output == Or) : f.acc);
+            else if (g.output == And)
+                bdd = BDD::bigAnd(f.args);
+            else if (g.output == Or)
+                bdd = BDD::bigOr(f.args);
+            else if (g.output == Xor)
+                bdd = f.acc;
+            else if (g.output == Ite)
+                bdd = f.args[0].Ite(f.args[1], f.args[2]);
+            else if (g.output == Ex)
+                bdd = f.args[0].ExistAbstract(g.quants);
+            else if (g.output == All)
+                bdd = f.args[0].UnivAbstract(g.quants);
+            else
+                assert(false);
+            bdds[f.gate] = bdd;
+            built[f.gate] = true;
+            peakalive = std::max(peakalive, ++alive);
+            if (STATISTICS) { LOG(2," (" << bdd.NodeCount() << " nodes, " << alive << " live)"); }
+            if (overBudget(bdd)) return;
+            LOG(2, endl);
+            Watchdog::check(f.gate);
+            stack.pop_back();                           // invalidates f
+            if (Checkpoint::due()) save();
+        }
+    };
+    if (resumed == Checkpoint::gates) {
+        restore();
+        resumed = Checkpoint::none;
+        build();
+    }
+    for (int root : roots) {
+        if (!built[abs(root)]) {
+            stack.push_back(frame(abs(root)));
+            build();
+        }
+        if (overbudget) return vector<BDD>();
     }
-    matrix = toBdd(c.getOutput()); // final result
+    if (skipped>0) LOG(2, "- skipped " << skipped << " of " << cone << " gates" << endl);
+    if (minimized>0) LOG(2, "- simplified " << minimized << " arguments on don't-cares" << endl);
+    LOG(2, "- peak " << peakalive << " live gate BDDs" << endl);
+    vector<BDD> result;
+    for (int root : roots) result.push_back(toBdd(root));
+    return result;
 }
 
-void Solver::prefix2bdd() {
+template <class BDD>
+void Solver<BDD>::prefix2bdd() {
     LOG(1,"Quantifying Prefix" << endl);
-    // Quantify blocks from last to second, unless fully resolved
-    for (int i=c.maxBlock()-1; i>0; i--) {
+    Watchdog::phase("quantifying the prefix", "block");
+    // Quantify blocks from last to second, unless fully resolved.
+    // A checkpoint holds the next block and the matrix.
+    int start = c.maxBlock()-1;
+    if (resumed == Checkpoint::blocks) {
+        std::istream& file = Checkpoint::input();
+        vector<int> next = Checkpoint::readInts(file);
+        vector<BDD> saved;
+        if (next.size() != 1 || !BDD::Read(file, saved) || saved.size() != 1) Checkpoint::damaged();
+        start = next[0];
+        matrix = saved[0];
+        Checkpoint::close();
+        resumed = Checkpoint::none;
+        LOG(1, "- resumed at block " << start+1 << endl);
+    }
+    for (int i=start; i>0; i--) {
+        Watchdog::check(i+1);
+        if (Checkpoint::due()) {
+            std::ostream& file = Checkpoint::create(c, Checkpoint::blocks);
+            Checkpoint::writeInts(file, {i});
+            BDD::Write(file, {matrix});
+            Checkpoint::commit();
+        }
         if (matrix.isConstant()) {
             LOG(2, "(early termination)" << endl);
             break;
@@ -146,6 +597,189 @@ void Solver::prefix2bdd() {
         else
             matrix = matrix.ExistAbstract(b.variables);
         if (STATISTICS) { LOG(2," (" << matrix.NodeCount() << " nodes)"); }
+        if (overBudget(matrix)) return;
         LOG(2,endl);
     }
 }
+
+// The matrix is kept as a conjunction of partitions (negated if dual).
+// An and-gate at the output provides the partitions directly; for an or-gate
+// we use the negated arguments, as in (A \/ B) = !(!A /\ !B).
+// Adjacent partitions are clustered while their conjunction stays within
+// PARTITION nodes.
+
+template <class BDD>
+void Solver<BDD>::matrix2partitions() {
+    LOG(1,"Building BDD partitions for Matrix" << endl;);
+    Watchdog::phase("building the matrix partitions", "gate");
+    int out = c.getOutput();
+    vector<int> roots({out});
+    dual = false;
+    if (abs(out) >= c.maxVar()) {
+        const Gate& g = c.getGate(abs(out));
+        if (g.output == And || g.output == Or) {
+            roots = g.inputs;
+            if (g.output == Or)
+                for (int& root : roots) root = -root;
+            dual = ((out < 0) == (g.output == And));
+        }
+    }
+    vector<BDD> parts = gates2bdd(roots);
+    if (overbudget) return;
+
+    partitions.clear();
+    for (const BDD& part : parts) {
+        if (part == BDD(true)) continue; // neutral element
+        if (partitions.size()>0) {
+            BDD cluster = partitions.back();
+            cluster *= part;
+            if (cluster.NodeCount() <= (size_t)PARTITION) {
+                partitions.back() = cluster;
+                continue;
+            }
+        }
+        partitions.push_back(part);
+    }
+    LOG(2,"- " << parts.size() << " partitions in " << partitions.size() << " clusters" << endl);
+
+    // each cluster can ignore the valuations that its neighbours exclude
+    if (DONTCARE) {
+        size_t before = 0, after = 0;
+        for (size_t i=0; i<partitions.size(); i++) {
+            before += partitions[i].NodeCount();
+            size_t lo = (i > CANDIDATES ? i-CANDIDATES : 0);
+            size_t hi = std::min(partitions.size(), i+CANDIDATES+1);
+            for (size_t j=lo; j<hi; j++)
+                if (j != i) partitions[i] = partitions[i].Minimize(partitions[j]);
+            after += partitions[i].NodeCount();
+        }
+        LOG(2,"- don't-cares: " << before << " -> " << after << " nodes" << endl);
+    }
+}
+
+// Order the partitions that depend on variables xs, as in IWLS95:
+// next take the partition that enables quantification of most variables,
+// i.e. the last remaining partition that depends on them.
+// Break ties by preferring the smallest support.
+
+template <class BDD>
+vector<BDD> iwlsOrder(const vector<BDD>& parts, const vector<vector<int>>& supports, const std::set<int>& xs) {
+    std::map<int,int> count;     // number of remaining partitions depending on each x
+    for (const vector<int>& support : supports)
+        for (int x : support)
+            if (xs.count(x)>0) count[x]++;
+
+    vector<BDD> result;
+    vector<bool> done(parts.size(), false);
+    for (size_t k=0; k<parts.size(); k++) {
+        int best=-1, bestgain=-1;
+        for (size_t i=0; i<parts.size(); i++) {
+            if (done[i]) continue;
+            int gain=0;
+            for (int x : supports[i])
+                if (xs.count(x)>0 && count[x]==1) gain++;
+            if (gain>bestgain || (gain==bestgain && supports[i].size()<supports[best].size())) {
+                best = i;
+                bestgain = gain;
+            }
+        }
+        done[best] = true;
+        for (int x : supports[best])
+            if (xs.count(x)>0) count[x]--;
+        result.push_back(parts[best]);
+    }
+    return result;
+}
+
+// Forall distributes over the partitions, Exists only combines the partitions
+// that depend on the block, using and-exists in the IWLS95 schedule.
+// For a dual (negated) matrix, the quantifiers are swapped.
+
+// Bucket elimination: quantify the variables one at a time, highest index
+// first, each over the conjunction of the partitions that depend on it.
+// Returns false when a bucket exceeds the budget.
+
+template <class BDD>
+bool Solver<BDD>::bucketElimination(vector<BDD>& parts, vector<vector<int>>& supports, vector<int> xs) {
+    std::sort(xs.begin(), xs.end(), std::greater<int>());
+    for (int x : xs) {
+        vector<BDD> bucket, rest;
+        vector<vector<int>> restsupports;
+        for (size_t k=0; k<parts.size(); k++) {
+            if (std::binary_search(supports[k].begin(), supports[k].end(), x))
+                bucket.push_back(parts[k]);
+            else {
+                rest.push_back(parts[k]);
+                restsupports.push_back(supports[k]);
+            }
+        }
+        if (bucket.size()==0) continue;
+        Watchdog::check();
+        BDD result = BDD::bigAndExists(bucket, vector<int>({x}));
+        if (overBudget(result)) return false;
+        if (!(result == BDD(true))) {
+            rest.push_back(result);
+            restsupports.push_back(result.Support());
+        }
+        parts = rest;
+        supports = restsupports;
+        if (result == BDD(false)) break;
+    }
+    return true;
+}
+
+template <class BDD>
+void Solver<BDD>::prefix2partitions() {
+    LOG(1,"Quantifying Prefix on Partitions" << endl);
+    Watchdog::phase("quantifying the prefix on partitions", "block");
+    for (int i=c.maxBlock()-1; i>0; i--) {
+        Watchdog::check(i+1);
+        if (partitions.size()==0 || 
+            std::find(partitions.begin(), partitions.end(), BDD(false)) != partitions.end()) {
+            LOG(2, "(early termination)" << endl);
+            break;
+        }
+        Block b = c.getBlock(i);
+        LOG(2,"- block " << i+1 << " (" << b.size() << "x " << Qtext[b.quantifier] << "): ");
+        std::set<int> xs(b.variables.begin(), b.variables.end());
+        vector<BDD> independent, dependent;
+        vector<vector<int>> supports;
+        for (const BDD& part : partitions) {
+            vector<int> support = part.Support();
+            if (std::any_of(support.begin(), support.end(), [&xs](int x) { return xs.count(x)>0; })) {
+                dependent.push_back(part);
+                supports.push_back(support);
+            } else
+                independent.push_back(part);
+        }
+        if ((b.quantifier == Forall) != dual) {
+            for (const BDD& part : dependent) {
+                Watchdog::check(i+1);
+                BDD result = part.UnivAbstract(b.variables);
+                if (overBudget(result)) return;
+                if (!(result == BDD(true))) independent.push_back(result);
+            }
+        } else if (QUANTIFY == 3) {
+            if (!bucketElimination(dependent, supports, b.variables)) return;
+            independent.insert(independent.end(), dependent.begin(), dependent.end());
+        } else if (dependent.size()>0) {
+            BDD result = BDD::bigAndExists(iwlsOrder(dependent, supports, xs), b.variables);
+            if (overBudget(result)) return;
+            if (!(result == BDD(true))) independent.push_back(result);
+        }
+        partitions = independent;
+        LOG(2, dependent.size() << " dependent, " << partitions.size() << " partitions");
+        if (STATISTICS) {
+            size_t nodes = 0;
+            for (const BDD& part : partitions) nodes += part.NodeCount();
+            LOG(2," (" << nodes << " nodes)");
+        }
+        LOG(2,endl);
+    }
+    matrix = BDD::bigAnd(partitions); // only the outermost block remains
+    if (dual) matrix = !matrix;
+}
+
+// The BDD packages that can be used by the Solver
+template class Solver<Sylvan_Bdd>;
+template class Solver<Builtin_Bdd>;
@@ -4,25 +4,42 @@
 #ifndef SOLVER_H
 #define SOLVER_H
 
-#include "bdd_sylvan.hpp"
 #include "circuit.hpp"
-#include <set>
+#include "checkpoint.hpp"
 
+// The Solver is generic in the BDD package, see Bdd_base for its interface
+
+template <class BDD>
 class Solver {
     private:
         const Circuit& c;   // the circuit to solve
-        Sylvan_Bdd matrix;  // keeps current state of algorithm
-        vector<std::set<int>> cleanup; // bdds that can be cleaned up at each stage
+        BDD matrix;         // keeps current state of algorithm
+        vector<BDD> partitions;        // partitioned matrix (-m): conjunction
+        bool dual=false;               // partitioned matrix is negated (top-level or)
+        vector<vector<int>> schedule;  // order of the inputs of each gate (-o=1)
+        bool overbudget=false;         // some BDD exceeded BUDGET nodes
+        Checkpoint::Phase resumed = Checkpoint::none; // phase to continue (-resume)
 
         // The following functions must be called in this order:
-        void matrix2bdd();  // transform all gates up to output to BDD 
+        void matrix2bdd();  // transform gates in the cone of output to BDD, on demand
         void prefix2bdd();  // quantifier elimination up to first block
         bool verdict() const;
-        void computeCleanup(); // compute when bdds can be cleaned up
+
+        // Alternatively (-m), keep the top-level and/or of the matrix partitioned:
+        void matrix2partitions(); // transform arguments of the output to BDDs, and cluster them
+        void prefix2partitions(); // early quantification on partitions up to first block
+        bool bucketElimination(vector<BDD>& parts, vector<vector<int>>& supports, vector<int> xs); // -a=3
+
+        vector<BDD> gates2bdd(const vector<int>& roots); // BDDs for roots, on demand
+        void computeSchedule(const vector<int>& roots); // input order with low peak memory
+        bool overBudget(const BDD& bdd); // check bdd against BUDGET (-n)
+        bool approximate(); // try to decide with small over/under-approximations (-l)
+        void dump() const;  // write the matrix to DUMP (-dump)
 
     public:
         Solver(const Circuit& circuit);
         bool solve();
+        bool exceeded() const { return overbudget; } // solve() gave up: no verdict
         Valuation example() const; // can only be called after solve()
 };
 
@@ -0,0 +1,239 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "solver_cegar.hpp"
+#include "watchdog.hpp"
+#include "settings.hpp"
+
+using std::endl;
+
+CEGAR_Solver::CEGAR_Solver(const Circuit& circuit) : c(circuit) {
+    nodes.push_back({false, {}}); // unused
+    nodes.push_back({false, {}}); // TRUE = and()
+}
+
+bool CEGAR_Solver::applicable(const Circuit& circuit) {
+    for (int i=circuit.maxVar(); i<circuit.maxGate(); i++) {
+        Connective conn = circuit.getGate(i).output;
+        if (conn != And && conn != Or && conn != Xor && conn != Ite) return false;
+    }
+    return true;
+}
+
+/* and-inverter graphs */
+
+int CEGAR_Solver::newVar() {
+    nodes.push_back({true, {}});
+    return nodes.size()-1;
+}
+
+int CEGAR_Solver::mkAnd(vector<int> args) {
+    args.erase(std::remove(args.begin(), args.end(), TRUE), args.end());
+    std::sort(args.begin(), args.end());
+    args.erase(std::unique(args.begin(), args.end()), args.end());
+    for (int arg : args)
+        if (arg == -TRUE || std::binary_search(args.begin(), args.end(), -arg))
+            return -TRUE; // absorbing element, or contradiction
+    if (args.size() == 0) return TRUE;
+    if (args.size() == 1) return args[0];
+    auto it = hashed.find(args);
+    if (it != hashed.end()) return it->second;
+    nodes.push_back({false, args});
+    hashed[args] = nodes.size()-1;
+    return nodes.size()-1;
+}
+
+int CEGAR_Solver::mkOr(vector<int> args) {
+    for (int& arg : args) arg = -arg;
+    return -mkAnd(args);
+}
+
+// replace variables by literals (constants or fresh variables)
+int CEGAR_Solver::substitute(int lit, const map<int,int>& sub, map<int,int>& done) {
+    int i = abs(lit);
+    int result = i;
+    auto s = sub.find(i);
+    if (s != sub.end())
+        result = s->second;
+    else if (!nodes[i].isvar && i != TRUE) {
+        auto d = done.find(i);
+        if (d != done.end())
+            result = d->second;
+        else {
+            vector<int> args = nodes[i].inputs; // copy, since nodes may grow
+            for (int& arg : args) arg = substitute(arg, sub, done);
+            result = mkAnd(args);
+            done[i] = result;
+        }
+    }
+    return (lit > 0 ? result : -result);
+}
+
+/* SAT */
+
+int CEGAR_Solver::encode(Encoding& e, int lit) {
+    int i = abs(lit);
+    auto it = e.satvar.find(i);
+    int v;
+    if (it != e.satvar.end())
+        v = it->second;
+    else if (nodes[i].isvar)
+        v = e.satvar[i] = e.sat.newVar();
+    else {
+        vector<int> args;
+        for (int arg : vector<int>(nodes[i].inputs)) args.push_back(encode(e, arg));
+        v = e.satvar[i] = e.sat.newVar();
+        vector<int> clause({v}); // v <=> and(args)
+        for (int arg : args) {
+            e.sat.addClause({-v, arg});
+            clause.push_back(-arg);
+        }
+        e.sat.addClause(clause);
+    }
+    return (lit > 0 ? v : -v);
+}
+
+bool CEGAR_Solver::propositional(const Game& g, vector<bool>& move) {
+    Encoding e;
+    vector<int> xs;
+    if (g.blocks.size() > 0)
+        for (int x : g.blocks[0]) xs.push_back(encode(e, x));
+    e.sat.addClause({encode(e, g.first == Exists ? g.matrix : -g.matrix)});
+    if (!e.sat.solve()) return false;
+    move.clear();
+    for (int x : xs) move.push_back(e.sat.value(x));
+    return true;
+}
+
+/* RAReQS */
+
+// The abstraction of the first player is the game on its own block and
+// copies of the inner blocks, where the opponent's block is fixed to each
+// counter-move found so far: the conjunction (Exists) or disjunction (Forall)
+// of these expansions. A candidate move from the abstraction is checked by
+// solving the remaining game for the opponent. If the opponent wins, its
+// move refines the abstraction. With two blocks, the abstraction is
+// propositional, and we keep adding to a single SAT solver.
+
+bool CEGAR_Solver::rareqs(const Game& g, vector<bool>& move, int depth) {
+    if (g.blocks.size() <= 1) return propositional(g, move);
+
+    const Quantifier q = g.first;
+    const Quantifier other = (q == Exists ? Forall : Exists);
+    const vector<int>& xs = g.blocks[0];
+    const vector<int>& ys = g.blocks[1];
+
+    Game alpha({q, vector<vector<int>>(std::max((size_t)1, g.blocks.size()-2)), q==Exists ? TRUE : -TRUE});
+    alpha.blocks[0] = xs;
+    Encoding e; // for two blocks only
+    if (g.blocks.size() == 2)
+        for (int x : xs) encode(e, x);
+
+    int iterations = 0;
+    while (true) {
+        vector<bool> tau;
+        if (g.blocks.size() == 2) {
+            if (!e.sat.solve()) return false;
+            for (int x : xs) tau.push_back(e.sat.value(e.satvar[x]));
+        } else {
+            Game a = alpha;
+            while (a.blocks.size() > 1 && a.blocks.back().size() == 0) a.blocks.pop_back();
+            vector<bool> m;
+            if (!rareqs(a, m, depth+1)) return false;
+            tau = vector<bool>(m.begin(), m.begin()+xs.size());
+        }
+
+        map<int,int> sub, done;
+        for (size_t i=0; i<xs.size(); i++) sub[xs[i]] = (tau[i] ? TRUE : -TRUE);
+        Game rest({other, vector<vector<int>>(g.blocks.begin()+1, g.blocks.end()), substitute(g.matrix, sub, done)});
+        vector<bool> mu;
+        if (!rareqs(rest, mu, depth+1)) {
+            LOG(3,"- level " << depth << ": " << iterations << " refinements" << endl);
+            move = tau;
+            return true;
+        }
+
+        // refine: expand the game on the counter-move mu, with fresh inner variables
+        iterations++;
+        refinements++;
+        Watchdog::check(refinements);
+        sub.clear(); done.clear();
+        for (size_t i=0; i<ys.size(); i++) sub[ys[i]] = (mu[i] ? TRUE : -TRUE);
+        for (size_t k=2; k<g.blocks.size(); k++)
+            for (int x : g.blocks[k]) {
+                int y = newVar();
+                sub[x] = y;
+                alpha.blocks[k-2].push_back(y);
+            }
+        int copy = substitute(g.matrix, sub, done);
+        if (g.blocks.size() == 2)
+            e.sat.addClause({encode(e, q == Exists ? copy : -copy)});
+        else
+            alpha.matrix = (q == Exists ? mkAnd({alpha.matrix, copy}) : mkOr({alpha.matrix, copy}));
+    }
+}
+
+bool CEGAR_Solver::solve() {
+    LOG(1,"Solving by Expansion (CEGAR)" << endl);
+    Watchdog::phase("expansion (CEGAR)", "refinement");
+    const int first = c.maxVar();
+    vector<int> lits(c.maxGate(), 0); // circuit variable/gate -> literal
+    for (int i=1; i<first; i++) lits[i] = newVar();
+    varnodes = vector<int>(lits.begin(), lits.begin()+first);
+    const auto lit = [&lits](int i) { return (i>0 ? lits[i] : -lits[-i]); };
+    for (int i=first; i<c.maxGate(); i++) {
+        const Gate& g = c.getGate(i);
+        vector<int> args;
+        for (int arg : g.inputs) args.push_back(lit(arg));
+        if (g.output == And)
+            lits[i] = mkAnd(args);
+        else if (g.output == Or)
+            lits[i] = mkOr(args);
+        else if (g.output == Xor) { // a ^ b = (a /\ !b) \/ (!a /\ b)
+            lits[i] = -TRUE;
+            for (int arg : args)
+                lits[i] = mkOr({mkAnd({lits[i], -arg}), mkAnd({-lits[i], arg})});
+        }
+        else // Ite
+            lits[i] = mkOr({mkAnd({args[0], args[1]}), mkAnd({-args[0], args[2]})});
+    }
+    game.matrix = lit(c.getOutput());
+
+    // alternating blocks, without empty ones
+    game.first = Exists; // for a propositional formula
+    for (int i=0; i<c.maxBlock(); i++) {
+        const Block& b = c.getBlock(i);
+        if (b.size() == 0) continue;
+        if (game.blocks.size() == 0) game.first = b.quantifier;
+        if (game.blocks.size() == 0 || (game.blocks.size()%2 == 1) != (b.quantifier == game.first))
+            game.blocks.push_back(vector<int>()); // quantifier alternation
+        for (int x : b.variables) game.blocks.back().push_back(lits[x]);
+    }
+    LOG(2,"- " << game.blocks.size() << " alternating blocks, " << nodes.size() << " nodes" << endl);
+
+    bool win = rareqs(game, move, 0);
+    LOG(2,"- " << refinements << " refinements" << endl);
+    verdict = (win == (game.first == Exists));
+    return verdict;
+}
+
+// The first block of the game consists of the top-level variables
+Valuation CEGAR_Solver::example() const {
+    Valuation valuation;
+    if (c.maxBlock() == 0 || verdict != (c.getBlock(0).quantifier == Exists))
+        return valuation; // no example possible: empty valuation
+    map<int,bool> value;
+    for (size_t i=0; i<move.size(); i++) value[game.blocks[0][i]] = move[i];
+    Quantifier q = c.getBlock(0).quantifier;
+    for (int i=0; i<c.maxBlock(); i++) {
+        Block b = c.getBlock(i);
+        if (b.quantifier != q) break; // stop at first quantifier alternation
+        for (int v : b.variables)
+            valuation.push_back(pair<int,bool>({v, value[varnodes[v]]}));
+    }
+    return valuation;
+}
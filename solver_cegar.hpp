@@ -0,0 +1,69 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef SOLVER_CEGAR_H
+#define SOLVER_CEGAR_H
+
+#include <vector>
+#include <map>
+#include "sat.hpp"
+#include "circuit.hpp"
+
+// Solver for prenex QBFs without BDDs: recursive counterexample-guided
+// abstraction refinement over the quantifier blocks, as in RAReQS.
+// A player's abstraction is an expansion of the game on the opponent's
+// counter-moves found so far; propositional games are decided by SAT.
+// Gives the same verdict as Solver, the example may be a different one.
+
+class CEGAR_Solver {
+    private:
+        const Circuit& c;   // the circuit to solve
+
+        // Formulas are and-inverter graphs with structural hashing:
+        // node 1 is true, and literal -n is the negation of node n
+        struct Node {
+            bool isvar;
+            vector<int> inputs; // conjunction (if not a variable)
+        };
+        vector<Node> nodes;
+        map<vector<int>,int> hashed;
+        static constexpr int TRUE = 1;
+
+        int newVar();
+        int mkAnd(vector<int> args);
+        int mkOr(vector<int> args);
+        int substitute(int lit, const map<int,int>& sub, map<int,int>& done);
+
+        // A game has alternating blocks of node variables, starting with
+        // quantifier first. The player of the first block wins if the
+        // matrix becomes true (Exists) or false (Forall).
+        struct Game {
+            Quantifier first;
+            vector<vector<int>> blocks;
+            int matrix;
+        };
+        Game game;                      // the whole QBF
+        vector<int> varnodes;           // circuit variable -> node
+        vector<bool> move;              // winning move for the first block
+        int refinements = 0;
+
+        // returns whether the first player wins, and if so a winning move
+        bool rareqs(const Game& g, vector<bool>& move, int depth);
+        bool propositional(const Game& g, vector<bool>& move);
+        bool verdict;
+
+        // Tseitin encoding of nodes into a SAT solver
+        struct Encoding {
+            Sat sat;
+            map<int,int> satvar;        // node -> sat variable
+        };
+        int encode(Encoding& e, int lit);
+
+    public:
+        CEGAR_Solver(const Circuit& circuit);
+        static bool applicable(const Circuit& circuit); // only prenex circuits
+        bool solve();
+        Valuation example() const; // can only be called after solve()
+};
+
+#endif // SOLVER_CEGAR_H
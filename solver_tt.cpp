@@ -0,0 +1,134 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <cassert>
+#include "solver_tt.hpp"
+#include "watchdog.hpp"
+#include "settings.hpp"
+
+using std::endl;
+
+TT_Solver::TT_Solver(const Circuit& circuit) : c(circuit), matrix(false) { }
+
+bool TT_Solver::solve() {
+    TruthTable::setVars(c.maxVar()-1);
+    matrix2tt();
+    prefix2tt();
+    return verdict();
+}
+
+// Here we assume that either the matrix is constant, or all variables
+// except for the first (outermost) block have been eliminated
+bool TT_Solver::verdict() const {
+    if (matrix.isConstant()) {
+        return matrix == TruthTable(true);
+    }
+    else { // there must be at least one variable
+        return (c.getBlock(0).quantifier == Exists);
+    }
+}
+
+// Same example as Solver::example, since TruthTable::PickOneCube makes
+// the same choices as Sylvan
+Valuation TT_Solver::example() const {
+    Valuation valuation;
+    if (c.maxBlock() == 0 ||
+        verdict() != (c.getBlock(0).quantifier == Exists)) {
+        return valuation; // no example possible: empty valuation
+    } else {
+        // compute list of all top-level variables
+        vector<int> vars;
+        Quantifier q = c.getBlock(0).quantifier;
+        for (int i=0; i<c.maxBlock(); i++) {
+            Block b = c.getBlock(i);
+            if (b.quantifier != q) break; // stop at first quantifier alternation
+            for (int v : b.variables) vars.push_back(v);
+        }
+        vector<bool> val;
+        if (q==Exists)
+            val = matrix.PickOneCube(vars);
+        else
+            val = (!matrix).PickOneCube(vars);
+        for (size_t i=0; i<vars.size(); i++)
+            valuation.push_back(pair<int,bool>({vars[i], val[i]}));
+        return valuation;
+    }
+}
+
+// Evaluate the gates in the cone of the output in index order.
+// Tables are dropped after their last use.
+
+void TT_Solver::matrix2tt() {
+    LOG(1,"Building Truth Tables for Matrix (2^" << TruthTable::maxVars() << " bits)" << endl);
+    Watchdog::phase("building the truth tables", "gate");
+    const int first = c.maxVar();
+    const int out = abs(c.getOutput());
+    std::map<int,TruthTable> tables;        // tables of the live gates
+    auto lookup = [&](int lit)->TruthTable {
+        int i = abs(lit);
+        TruthTable t = (i < first ? TruthTable(i) : tables.at(i));
+        return (lit > 0 ? t : !t);
+    };
+
+    vector<int> uses(std::max(out,first)+1, 0); // number of pending users of each gate
+    uses[out] = 1;                              // the output itself is used by the prefix
+    for (int i=out; i>=first; i--) {
+        if (uses[i]==0) continue;               // gate not reachable from the output
+        for (int arg: c.getGate(i).inputs) uses[abs(arg)]++;
+    }
+
+    for (int i=first; i<=out; i++) {
+        if (uses[i]==0) continue;
+        const Gate& g = c.getGate(i);
+        LOG(2,"- gate " << c.varString(i) << ": " << Ctext[g.output] << "(" << g.inputs.size() << ")" << endl);
+        TruthTable table(false);
+        if (g.output == And || g.output == Or) {
+            const TruthTable absorbing(g.output == Or);
+            table = TruthTable(g.output == And); // neutral element
+            for (int arg : g.inputs) {
+                if (g.output == And) table *= lookup(arg); else table += lookup(arg);
+                if (table.isConstant() && table == absorbing) break;
+            }
+        }
+        else if (g.output == Xor) {
+            for (int arg : g.inputs) table ^= lookup(arg);
+        }
+        else if (g.output == Ite)
+            table = lookup(g.inputs[0]).Ite(lookup(g.inputs[1]), lookup(g.inputs[2]));
+        else if (g.output == Ex)
+            table = lookup(g.inputs[0]).ExistAbstract(g.quants);
+        else if (g.output == All)
+            table = lookup(g.inputs[0]).UnivAbstract(g.quants);
+        else
+            assert(false);
+        for (int arg : g.inputs) {
+            if (abs(arg) >= first && --uses[abs(arg)] == 0)
+                tables.erase(abs(arg));
+        }
+        tables.emplace(i, table);
+        Watchdog::check(i);
+    }
+    matrix = lookup(c.getOutput()); // final result
+}
+
+void TT_Solver::prefix2tt() {
+    LOG(1,"Quantifying Prefix" << endl);
+    Watchdog::phase("quantifying the prefix", "block");
+    // Quantify blocks from last to second, unless fully resolved
+    for (int i=c.maxBlock()-1; i>0; i--) {
+        Watchdog::check(i+1);
+        if (matrix.isConstant()) {
+            LOG(2, "(early termination)" << endl);
+            break;
+        }
+        Block b = c.getBlock(i);
+        LOG(2,"- block " << i+1 << " (" << b.size() << "x " << Qtext[b.quantifier] << ")" << endl);
+        if (b.quantifier == Forall)
+            matrix = matrix.UnivAbstract(b.variables);
+        else
+            matrix = matrix.ExistAbstract(b.variables);
+    }
+}
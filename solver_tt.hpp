@@ -0,0 +1,29 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef SOLVER_TT_H
+#define SOLVER_TT_H
+
+#include "truthtable.hpp"
+#include "circuit.hpp"
+
+// Solver for small QBFs, without BDDs: all gates are evaluated as packed
+// truth tables over all variables. Gives the same verdict and example as Solver.
+
+class TT_Solver {
+    private:
+        const Circuit& c;   // the circuit to solve
+        TruthTable matrix;  // keeps current state of algorithm
+
+        // The following functions must be called in this order:
+        void matrix2tt();   // evaluate gates in the cone of output
+        void prefix2tt();   // quantifier elimination up to first block
+        bool verdict() const;
+
+    public:
+        TT_Solver(const Circuit& circuit);
+        bool solve();
+        Valuation example() const; // can only be called after solve()
+};
+
+#endif // SOLVER_TT_H
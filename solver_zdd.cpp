@@ -0,0 +1,128 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <iostream>
+#include <vector>
+#include <set>
+#include "solver_zdd.hpp"
+#include "watchdog.hpp"
+#include "settings.hpp"
+
+using std::endl;
+
+ZDD_Solver::ZDD_Solver(Circuit& circuit) : c(circuit), matrix(Zdd::EMPTY) { }
+
+bool ZDD_Solver::eliminate() {
+    if (!matrix2zdd()) {
+        LOG(1,"Matrix is not a CNF, no clause-set elimination" << endl);
+        return false;
+    }
+    prefix2zdd();
+    std::vector<std::vector<int>> clauses = zdd.clauses(matrix);
+    LOG(1,"- " << clauses.size() << " clauses remain" << endl);
+    c.setClauses(clauses);
+    return true;
+}
+
+// The matrix is a CNF if the output is a conjunction of disjunctions of
+// literals, where nested and/or gates (also negated ones) are flattened.
+
+bool ZDD_Solver::matrix2zdd() {
+    LOG(1,"Building Clause Set (ZDD) for Matrix" << endl);
+    const int first = c.maxVar();
+    auto isConn = [&](int lit, Connective conn) {
+        const Gate& g = c.getGate(abs(lit));
+        if (g.output != And && g.output != Or) return false;
+        return g.output == (lit > 0 ? conn : (conn == And ? Or : And)) || g.size() == 1;
+    };
+
+    auto disj = [&](auto& disj, int lit, std::vector<int>& clause)->bool {
+        if (abs(lit) < first) { clause.push_back(lit); return true; }
+        if (!isConn(lit, Or)) return false;
+        for (int arg : c.getGate(abs(lit)).inputs)
+            if (!disj(disj, lit > 0 ? arg : -arg, clause)) return false;
+        return true;
+    };
+
+    std::set<int> done;
+    auto conj = [&](auto& conj, int lit)->bool {
+        if (!done.insert(lit).second) return true;
+        if (abs(lit) >= first && isConn(lit, And)) {
+            for (int arg : c.getGate(abs(lit)).inputs)
+                if (!conj(conj, lit > 0 ? arg : -arg)) return false;
+            return true;
+        }
+        std::vector<int> clause;
+        if (!disj(disj, lit, clause)) return false;
+        matrix = zdd.unite(matrix, zdd.clause(clause));
+        return true;
+    };
+
+    if (!conj(conj, c.getOutput())) return false;
+    matrix = zdd.minimal(matrix);
+    LOG(2,"- " << zdd.clauseCount(matrix) << " clauses, " << zdd.nodeCount(matrix) << " nodes" << endl);
+    return true;
+}
+
+// Report whether the ZDD has more than ZDD nodes. The operation cache only
+// serves one elimination step. The nodes are only counted when there are
+// more than ZDD of them in total, and then unreachable ones are dropped.
+bool ZDD_Solver::dense() {
+    zdd.flush();
+    if (zdd.size() <= (size_t)ZDD) return false;
+    size_t count = zdd.nodeCount(matrix);
+    if (count > (size_t)ZDD) {
+        LOG(2," (dense: " << count << " nodes)" << endl);
+        return true;
+    }
+    if (zdd.size() > 2*count) matrix = zdd.compact(matrix);
+    return false;
+}
+
+// Quantify blocks from last to second, unless fully resolved.
+// Existential variables are resolved in order of the least growth. Their
+// occurrences are counted once per block, and then updated with the clauses
+// that each step adds and removes.
+
+void ZDD_Solver::prefix2zdd() {
+    LOG(1,"Eliminating Inner Blocks by Resolution" << endl);
+    Watchdog::phase("resolution on clause sets (ZDD)", "variable");
+    for (int i=c.maxBlock()-1; i>0; i--) {
+        if (matrix == Zdd::EMPTY || matrix == Zdd::BASE) {
+            LOG(2, "(early termination)" << endl);
+            return;
+        }
+        Block b = c.getBlock(i);
+        LOG(2,"- block " << i+1 << " (" << b.size() << "x " << Qtext[b.quantifier] << ")");
+        std::vector<int> todo = b.variables;
+        std::unordered_map<int, std::pair<double,double>> occurrences;
+        if (b.quantifier == Exists) occurrences = zdd.occurrences(matrix);
+        while (todo.size()>0) {
+            size_t best = 0;
+            if (b.quantifier == Exists) {
+                double bestcost = 0;
+                for (size_t k=0; k<todo.size(); k++) {
+                    auto [pos, neg] = occurrences[todo[k]];
+                    double cost = pos*neg - pos - neg;
+                    if (k==0 || cost < bestcost) { best = k; bestcost = cost; }
+                }
+                Zdd::Node old = matrix;
+                matrix = zdd.resolve(matrix, todo[best]);
+                for (auto& [x, occ] : zdd.occurrences(zdd.subtract(matrix, old))) {
+                    occurrences[x].first += occ.first;
+                    occurrences[x].second += occ.second;
+                }
+                for (auto& [x, occ] : zdd.occurrences(zdd.subtract(old, matrix))) {
+                    occurrences[x].first -= occ.first;
+                    occurrences[x].second -= occ.second;
+                }
+            } else {
+                matrix = zdd.reduce(matrix, todo[best]);
+            }
+            Watchdog::check(todo[best]);
+            todo.erase(todo.begin()+best);
+            if (dense()) return;
+        }
+        LOG(2,": " << zdd.clauseCount(matrix) << " clauses" << endl);
+    }
+}
@@ -0,0 +1,31 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef SOLVER_ZDD_H
+#define SOLVER_ZDD_H
+
+#include "zdd.hpp"
+#include "circuit.hpp"
+
+// Clause-set engine for QBFs whose matrix is a CNF: the clauses are kept
+// in a ZDD, free of subsumed clauses, and the inner blocks are eliminated by
+// resolution (exists) and universal reduction (forall). It stops before the
+// outermost block, or when the ZDD grows beyond ZDD nodes. The remaining
+// clauses replace the matrix of the circuit, to be finished with BDDs.
+
+class ZDD_Solver {
+    private:
+        Circuit& c;         // the circuit to simplify
+        Zdd zdd;
+        Zdd::Node matrix;   // keeps current state of algorithm
+
+        bool matrix2zdd();  // false if the matrix is not a CNF
+        void prefix2zdd();  // eliminate variables from inner blocks
+        bool dense();       // ZDD too large, continue with BDDs
+
+    public:
+        ZDD_Solver(Circuit& circuit);
+        bool eliminate();   // false if not applicable (circuit unchanged)
+};
+
+#endif // SOLVER_ZDD_H
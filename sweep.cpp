@@ -0,0 +1,86 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include "sweep.hpp"
+#include "bdd_sylvan.hpp"
+#include "bdd_builtin.hpp"
+#include "watchdog.hpp"
+#include "settings.hpp"
+
+using std::endl;
+
+template <class BDD>
+int Sweeper<BDD>::sweep(size_t limit) {
+    LOG(1,"Sweeping Gates (BDDs up to " << limit << " nodes)" << endl);
+    Watchdog::phase("sweeping", "gate");
+    const int first = c.maxVar();
+    vector<BDD> bdds(c.maxGate(), BDD(false));  // gate BDDs, or cut points
+    vector<int> lits(c.maxGate(), 0);           // replacement of each gate (see Circuit::merge)
+    map<size_t,int> table;                      // BDD -> first variable/gate with it
+    const auto toBdd = [&bdds](int i)->BDD { return (i>0 ? bdds[i] : !bdds[-i]); };
+    const auto find = [&](const BDD& bdd)->int { // earlier literal with this BDD, or 0
+        for (int sign : {1, -1}) {
+            BDD b = (sign>0 ? bdd : !bdd);
+            auto it = table.find(b.Hash());
+            if (it != table.end() && bdds[it->second] == b) return sign * it->second;
+        }
+        return 0;
+    };
+    for (int i=1; i<first; i++) {
+        bdds[i] = BDD(i);
+        table[bdds[i].Hash()] = i;
+    }
+
+    int merged = 0, abandoned = 0;
+    int constant = 0; // the gate that becomes constant
+    for (int i=first; i<c.maxGate(); i++) {
+        Watchdog::check(i);
+        const Gate& g = c.getGate(i);
+        vector<BDD> args;
+        for (int arg : g.inputs) args.push_back(toBdd(arg));
+        bool cut = false;
+        BDD bdd(false);
+        if (g.output == And)
+            bdd = BDD::bigAnd(args);
+        else if (g.output == Or)
+            bdd = BDD::bigOr(args);
+        else if (g.output == Xor)
+            for (const BDD& arg : args) bdd ^= arg;
+        else if (g.output == Ite)
+            bdd = args[0].Ite(args[1], args[2]);
+        else {
+            for (int x : args[0].Support())
+                cut = cut || (x >= first); // the cut point may depend on the bound variables
+            if (!cut)
+                bdd = (g.output == Ex ? args[0].ExistAbstract(g.quants) : args[0].UnivAbstract(g.quants));
+        }
+        if (cut || bdd.NodeCount() > limit) {
+            bdds[i] = BDD(i);
+            abandoned++;
+            continue;
+        }
+        bdds[i] = bdd;
+        int lit = find(bdd);
+        if (lit == 0 && bdd.isConstant() && constant == 0) {
+            constant = i;
+            lit = (bdd == BDD(true) ? i : -i);
+        }
+        if (lit != 0) {
+            lits[i] = lit;
+            merged++;
+            LOG(3,"- merged " << c.varString(i) << endl);
+        }
+        if (lit == 0 || abs(lit) == i)
+            table[bdd.Hash()] = i;
+    }
+    LOG(2,"- " << merged << " gates merged, " << abandoned << " abandoned" << endl);
+    c.merge(lits);
+    return merged;
+}
+
+// The BDD packages that can be used by the Sweeper
+template class Sweeper<Sylvan_Bdd>;
+template class Sweeper<Builtin_Bdd>;
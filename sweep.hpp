@@ -0,0 +1,26 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "circuit.hpp"
+
+// The Sweeper is generic in the BDD package, see Bdd_base for its interface.
+// It builds the BDDs of all gates, in order, and merges the gates that are
+// constant, or equivalent to an earlier variable or gate, possibly negated.
+// A gate whose BDD exceeds the limit is abandoned: it is represented by a
+// fresh BDD variable (a cut point), so the gates above it can still be
+// compared. Quantifier gates over cut points are abandoned as well.
+
+template <class BDD>
+class Sweeper {
+    private:
+        Circuit& c;     // the circuit to reduce
+
+    public:
+        Sweeper(Circuit& circuit) : c(circuit) { }
+        int sweep(size_t limit); // returns the number of merged gates
+};
+
+#endif // SWEEP_H
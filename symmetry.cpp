@@ -0,0 +1,204 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "symmetry.hpp"
+#include "settings.hpp"
+
+using std::endl;
+
+constexpr int INDIVIDUALIZE = 16; // individualization steps per candidate symmetry
+
+// The initial colour of a variable is its block (free variables are fixed),
+// of a gate its connective; the output is fixed.
+
+Symmetry::Symmetry(Circuit& circuit) : c(circuit), users(circuit.maxGate()), initial(circuit.maxGate(), 0) {
+    const int first = c.maxVar();
+    for (int i=first; i<c.maxGate(); i++)
+        for (int k=0; k<c.getGate(i).size(); k++) {
+            int arg = c.getGate(i).inputs[k];
+            int position = (c.getGate(i).output == Ite ? k+1 : 0);
+            users[abs(arg)].push_back({arg > 0 ? i : -i, position});
+        }
+    int colours = 1;
+    for (int i=0; i<c.maxBlock(); i++)
+        for (int x : c.getBlock(i).variables)
+            initial[x] = colours+i;
+    colours += c.maxBlock();
+    for (int x=1; x<first; x++)
+        if (initial[x]==0) initial[x] = colours++;
+    for (int i=first; i<c.maxGate(); i++)
+        initial[i] = colours + c.getGate(i).output;
+    colours += Connectives.size();
+    int out = c.getOutput();
+    initial[abs(out)] = colours + (out > 0);
+}
+
+bool Symmetry::applicable(const Circuit& circuit) {
+    if (abs(circuit.getOutput()) < circuit.maxVar()) return false;
+    for (int i=circuit.maxVar(); i<circuit.maxGate(); i++) {
+        Connective conn = circuit.getGate(i).output;
+        if (conn != And && conn != Or && conn != Xor && conn != Ite) return false;
+    }
+    return true;
+}
+
+// A new colour consists of the old colour, and the multisets of signed
+// colours of the inputs and of the users. Both colourings share the new
+// colour names, and must have the same number of nodes of each colour.
+
+bool Symmetry::refine(vector<int>& a, vector<int>& b) const {
+    const int first = c.maxVar();
+    auto signature = [&](const vector<int>& col, int n) {
+        vector<int> ins, outs;
+        if (n >= first)
+            for (int arg : c.getGate(n).inputs) ins.push_back(arg > 0 ? col[arg]+1 : -col[-arg]-1);
+        for (auto [u, position] : users[n]) {
+            int user = 4*(col[abs(u)]+1) + position;
+            outs.push_back(u > 0 ? user : -user);
+        }
+        if (n < first || c.getGate(n).output != Ite)
+            std::sort(ins.begin(), ins.end());
+        std::sort(outs.begin(), outs.end());
+        vector<int> sig({col[n]});
+        sig.insert(sig.end(), ins.begin(), ins.end());
+        sig.push_back(0);
+        sig.insert(sig.end(), outs.begin(), outs.end());
+        return sig;
+    };
+
+    size_t colours = 0;
+    while (true) {
+        map<vector<int>,int> canon;
+        vector<int> na(a.size()), nb(b.size());
+        for (size_t n=0; n<a.size(); n++)
+            na[n] = canon.emplace(signature(a,n), canon.size()).first->second;
+        const size_t count = canon.size();
+        for (size_t n=0; n<b.size(); n++)
+            nb[n] = canon.emplace(signature(b,n), canon.size()).first->second;
+        if (canon.size() != count) return false;
+        vector<int> histogram(count, 0);
+        for (int col : na) histogram[col]++;
+        for (int col : nb) histogram[col]--;
+        if (std::any_of(histogram.begin(), histogram.end(), [](int h) { return h != 0; }))
+            return false;
+        a = na;
+        b = nb;
+        if (count == colours) return true;
+        colours = count;
+    }
+}
+
+vector<int> Symmetry::candidate(const vector<int>& a, const vector<int>& b) const {
+    const int colours = *std::max_element(a.begin(), a.end()) + 1;
+    vector<vector<int>> froma(colours), fromb(colours);
+    for (size_t n=0; n<a.size(); n++) {
+        if (a[n] != b[n]) froma[a[n]].push_back(n);
+        if (a[n] != b[n]) fromb[b[n]].push_back(n);
+    }
+    vector<int> perm(a.size());
+    for (size_t n=0; n<a.size(); n++) perm[n] = n;
+    for (int col=0; col<colours; col++)
+        for (size_t k=0; k<froma[col].size(); k++)
+            perm[froma[col][k]] = fromb[col][k];
+    return perm;
+}
+
+bool Symmetry::verify(const vector<int>& perm) const {
+    const int first = c.maxVar();
+    auto map = [&perm](int lit) { return (lit > 0 ? perm[lit] : -perm[-lit]); };
+    for (int n=1; n<c.maxGate(); n++) {
+        if (initial[perm[n]] != initial[n]) return false; // same block or connective
+        if (n < first) continue;
+        vector<int> image;
+        for (int arg : c.getGate(n).inputs) image.push_back(map(arg));
+        vector<int> inputs = c.getGate(perm[n]).inputs;
+        if (c.getGate(n).output != Ite) {
+            std::sort(image.begin(), image.end());
+            std::sort(inputs.begin(), inputs.end());
+        }
+        if (image != inputs) return false;
+    }
+    return true;
+}
+
+vector<int> Symmetry::search(const vector<int>& base, int v, int w) {
+    vector<int> a(base), b(base);
+    a[v] = b[w] = *std::max_element(base.begin(), base.end()) + 1;
+    for (int step=0; step<INDIVIDUALIZE; step++) {
+        if (!refine(a, b)) return vector<int>();
+        vector<int> perm = candidate(a, b);
+        if (verify(perm)) return perm;
+
+        // individualize the first node in a cell with more than one node
+        const int colours = *std::max_element(a.begin(), a.end()) + 1;
+        vector<int> count(colours, 0);
+        for (int col : a) count[col]++;
+        auto n = std::find_if(a.begin(), a.end(), [&count](int col) { return count[col] > 1; });
+        if (n == a.end()) return vector<int>(); // discrete, but not a symmetry
+        auto m = std::find(b.begin(), b.end(), *n);
+        *n = *m = colours;
+        individualized++;
+    }
+    return vector<int>();
+}
+
+// x <=lex perm(x) for the moved variables x of the outermost block, in
+// increasing order: L_i = (x_i -> y_i) /\ ((x_i <-> y_i) -> L_i+1)
+
+int Symmetry::leader(const vector<int>& perm) {
+    vector<int> xs = c.getBlock(0).variables;
+    std::sort(xs.begin(), xs.end());
+    int lex = 0; // true
+    for (auto it=xs.rbegin(); it!=xs.rend(); it++) {
+        int x = *it, y = perm[x];
+        if (x == y) continue;
+        int le = c.addGate(Gate(Or, vector<int>({-x, y})));
+        if (lex == 0)
+            lex = le;
+        else {
+            int eq = c.addGate(Gate(And, vector<int>({le, c.addGate(Gate(Or, vector<int>({x, -y})))})));
+            lex = c.addGate(Gate(And, vector<int>({le, c.addGate(Gate(Or, vector<int>({-eq, lex})))})));
+        }
+    }
+    return lex;
+}
+
+// Try each pair of variables in the same cell of the outermost block
+
+int Symmetry::breakSymmetries(int max) {
+    LOG(1,"Breaking Symmetries" << endl);
+    if (c.maxBlock() == 0) return 0;
+    vector<int> base(initial), copy(initial);
+    refine(base, copy);
+
+    map<int,vector<int>> cells;
+    for (int x : c.getBlock(0).variables) cells[base[x]].push_back(x);
+    vector<vector<int>> symmetries;
+    for (auto& [col, cell] : cells) {
+        std::sort(cell.begin(), cell.end());
+        for (size_t k=1; k<cell.size() && symmetries.size()<(size_t)max; k++) {
+            vector<int> perm = search(base, cell[0], cell[k]);
+            if (perm.size() == 0) continue;
+            LOG(3,"- symmetry " << c.varString(cell[0]) << " -> " << c.varString(cell[k]) << endl);
+            symmetries.push_back(perm);
+        }
+    }
+
+    vector<int> constraints; // only now the circuit is extended
+    for (const vector<int>& perm : symmetries)
+        constraints.push_back(leader(perm));
+    if (constraints.size() > 0) {
+        int lex = c.buildConn(And, constraints);
+        int out = c.getOutput();
+        if (c.getBlock(0).quantifier == Exists)
+            c.setOutput(c.addGate(Gate(And, vector<int>({lex, out}))));
+        else
+            c.setOutput(c.addGate(Gate(Or, vector<int>({-lex, out}))));
+    }
+    LOG(1,"- " << constraints.size() << " symmetries broken (" << individualized << " individualizations)" << endl);
+    return constraints.size();
+}
@@ -0,0 +1,44 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <vector>
+#include "circuit.hpp"
+
+// Symmetries of a prenex circuit are permutations of the variables that
+// map every block to itself, and the circuit to itself. They are found by
+// colour refinement on the gate graph: a pair of variables of the outermost
+// block is individualized, and the refined colourings induce a candidate
+// permutation, which is verified on the gates. The inputs of and/or/xor
+// are unordered, those of ite are ordered.
+//
+// A symmetry is broken by a lex-leader constraint on the outermost block:
+// the valuations of that block in one orbit are equivalent, so only the
+// lexicographically least one has to be considered. The constraint is
+// conjoined to the matrix (Exists) or assumed by it (Forall).
+
+class Symmetry {
+    private:
+        Circuit& c;         // the circuit to transform
+        vector<vector<pair<int,int>>> users; // per variable/gate: the signed gates using it,
+                                             // and the position (ite only)
+        vector<int> initial;        // colour per variable/gate: block, connective
+        int individualized = 0;     // statistics
+
+        // refine two colourings jointly, false if they become incompatible
+        bool refine(vector<int>& a, vector<int>& b) const;
+        // candidate mapping a-nodes to b-nodes of the same colour, fixing nodes if possible
+        vector<int> candidate(const vector<int>& a, const vector<int>& b) const;
+        bool verify(const vector<int>& perm) const;
+        vector<int> search(const vector<int>& base, int v, int w); // symmetry with v->w, or empty
+        int leader(const vector<int>& perm); // gate of the lex-leader constraint
+
+    public:
+        Symmetry(Circuit& circuit);
+        static bool applicable(const Circuit& circuit); // only prenex circuits
+        int breakSymmetries(int max); // returns the number of symmetries broken
+};
+
+#endif // SYMMETRY_H
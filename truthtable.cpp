@@ -0,0 +1,153 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <algorithm>
+#include <cassert>
+#include "truthtable.hpp"
+
+int TruthTable::nvars = 6;
+size_t TruthTable::nwords = 1;
+
+// MASK[p] selects the bits in a word where the variable at position p<6 is true
+static const uint64_t MASK[6] = {
+    0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+    0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL };
+
+void TruthTable::setVars(int n) {
+    nvars = std::max(n, 6);
+    nwords = 1ULL << (nvars-6);
+}
+
+// Variable i sits at bit position p=i-1: within a word for p<6,
+// otherwise it selects alternating runs of 2^(p-6) words.
+TruthTable::TruthTable(int i) : words(nwords) {
+    assert(1 <= i && i <= nvars);
+    int p = i-1;
+    for (size_t w=0; w<nwords; w++) {
+        if (p < 6)
+            words[w] = MASK[p];
+        else
+            words[w] = ((w >> (p-6)) & 1) ? ~0ULL : 0ULL;
+    }
+}
+
+bool TruthTable::isZero() const {
+    for (uint64_t w : words) if (w != 0) return false;
+    return true;
+}
+
+bool TruthTable::isConstant() const {
+    uint64_t w0 = words[0];
+    if (w0 != 0 && w0 != ~0ULL) return false;
+    for (uint64_t w : words) if (w != w0) return false;
+    return true;
+}
+
+TruthTable& TruthTable::operator+=(const TruthTable& other) {
+    for (size_t w=0; w<nwords; w++) words[w] |= other.words[w];
+    return *this;
+}
+
+TruthTable& TruthTable::operator*=(const TruthTable& other) {
+    for (size_t w=0; w<nwords; w++) words[w] &= other.words[w];
+    return *this;
+}
+
+TruthTable& TruthTable::operator^=(const TruthTable& other) {
+    for (size_t w=0; w<nwords; w++) words[w] ^= other.words[w];
+    return *this;
+}
+
+TruthTable TruthTable::Ite(const TruthTable& t, const TruthTable& e) const {
+    TruthTable result(*this);
+    for (size_t w=0; w<nwords; w++)
+        result.words[w] = (words[w] & t.words[w]) | (~words[w] & e.words[w]);
+    return result;
+}
+
+TruthTable TruthTable::operator!() const {
+    TruthTable result(*this);
+    for (uint64_t& w : result.words) w = ~w;
+    return result;
+}
+
+// Combine both halves of var with or (exists) / and (forall),
+// and store the result in both halves.
+void TruthTable::abstract(int var, bool exists) {
+    int p = var-1;
+    if (p < 6) {
+        const int shift = 1 << p;
+        for (uint64_t& w : words) {
+            uint64_t hi = (w & MASK[p]) >> shift;
+            uint64_t lo = w & ~MASK[p];
+            uint64_t r = (exists ? hi | lo : hi & lo);
+            w = r | (r << shift);
+        }
+    } else {
+        const size_t stride = 1ULL << (p-6);
+        for (size_t base=0; base<nwords; base += 2*stride) {
+            for (size_t k=base; k<base+stride; k++) {
+                uint64_t r = (exists ? words[k] | words[k+stride] : words[k] & words[k+stride]);
+                words[k] = words[k+stride] = r;
+            }
+        }
+    }
+}
+
+// Copy the half where var==value to both halves
+void TruthTable::cofactor(int var, bool value) {
+    int p = var-1;
+    if (p < 6) {
+        const int shift = 1 << p;
+        for (uint64_t& w : words) {
+            uint64_t r = (value ? (w & MASK[p]) >> shift : w & ~MASK[p]);
+            w = r | (r << shift);
+        }
+    } else {
+        const size_t stride = 1ULL << (p-6);
+        for (size_t base=0; base<nwords; base += 2*stride) {
+            for (size_t k=base; k<base+stride; k++) {
+                if (value) words[k] = words[k+stride];
+                else words[k+stride] = words[k];
+            }
+        }
+    }
+}
+
+TruthTable TruthTable::UnivAbstract(const std::vector<int>& variables) const {
+    TruthTable result(*this);
+    for (int x : variables) result.abstract(x, false);
+    return result;
+}
+
+TruthTable TruthTable::ExistAbstract(const std::vector<int>& variables) const {
+    TruthTable result(*this);
+    for (int x : variables) result.abstract(x, true);
+    return result;
+}
+
+// Same choice as Sylvan's PickOneCube: walking the variables in increasing
+// order, choose false whenever that leaves a satisfying assignment.
+// Returns the values in the order of the given variables.
+std::vector<bool> TruthTable::PickOneCube(const std::vector<int>& vars) const {
+    if (isZero()) return std::vector<bool>();
+    std::vector<int> index;
+    for (size_t i=0; i<vars.size(); i++)
+        index.push_back(i);
+    const auto cmp = [&vars](int a, int b) { return vars[a] < vars[b]; };
+    std::sort(index.begin(), index.end(), cmp);
+
+    std::vector<bool> val(vars.size(), false);
+    TruthTable current(*this);
+    for (int i : index) {
+        TruthTable low(current);
+        low.cofactor(vars[i], false);
+        if (!low.isZero())
+            current = low;
+        else {
+            val[i] = true;
+            current.cofactor(vars[i], true);
+        }
+    }
+    return val;
+}
@@ -0,0 +1,58 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef TRUTHTABLE_H
+#define TRUTHTABLE_H
+
+#include <vector>
+#include <cstdint>
+
+class TruthTable {
+
+// A TruthTable is a boolean function over the variables 1..n, stored as a
+// packed vector of 2^n bits: bit i holds the value for the assignment where
+// variable v gets value (i>>(v-1))&1. A table always occupies at least one
+// 64-bit word; small functions just ignore the extra variables.
+// All operations are word-level loops, which the compiler vectorizes.
+
+public:
+
+    // all truth tables are over variables 1..n, set this before use
+    static void setVars(int n);
+    static int maxVars()                            { return nvars; }
+
+/* public constructors */
+
+    // create constant true/false
+    TruthTable(bool b) : words(nwords, b ? ~0ULL : 0ULL) { }
+
+    // create variable(i)
+    TruthTable(int i);
+
+/* same API as Sylvan_Bdd */
+
+    bool isConstant() const;
+    bool operator==(const TruthTable& other) const  { return words == other.words; }
+    TruthTable& operator+=(const TruthTable& other);
+    TruthTable& operator*=(const TruthTable& other);
+    TruthTable& operator^=(const TruthTable& other);
+    TruthTable  operator!() const;
+    TruthTable  Ite(const TruthTable& t, const TruthTable& e) const;
+
+    TruthTable UnivAbstract(const std::vector<int>& variables) const;
+    TruthTable ExistAbstract(const std::vector<int>& variables) const;
+    std::vector<bool> PickOneCube(const std::vector<int>& variables) const;
+
+private:
+
+    static int nvars;       // number of variables (at least 6)
+    static size_t nwords;   // 2^(nvars-6)
+
+    std::vector<uint64_t> words;
+
+    void abstract(int var, bool exists);    // in-situ quantification of var
+    void cofactor(int var, bool value);     // in-situ restriction var:=value
+    bool isZero() const;
+};
+
+#endif // TRUTHTABLE_H
@@ -0,0 +1,113 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+#include "watchdog.hpp"
+#include "settings.hpp"
+
+using std::endl;
+using namespace std::chrono;
+
+constexpr int GRACE = 1; // seconds to reach a check point after the alarm
+
+std::atomic<bool> Watchdog::alarm(false);
+static std::atomic<const char*> current("parsing");
+static std::atomic<const char*> unit("step");
+static std::string reason;              // written before the alarm is raised
+static std::mutex writing;              // one writer of reason at a time
+static std::atomic<size_t> filled(0), total(0);
+
+static long resident() { // current resident memory in MB
+#ifdef __APPLE__
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) return 0;
+    return info.resident_size >> 20;
+#else
+    long pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm"); // in pages: size, resident, ...
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE) >> 20;
+#endif
+}
+
+// set the reason and raise the alarm, unless it was raised already
+static bool raise(std::atomic<bool>& alarm, const std::string& why) {
+    std::lock_guard<std::mutex> lock(writing);
+    if (alarm.load(std::memory_order_relaxed)) return false;
+    reason = why;
+    alarm.store(true, std::memory_order_release);
+    return true;
+}
+
+void Watchdog::start(int seconds, int megabytes, std::function<void(const std::string&)> atstop) {
+    if (seconds == 0 && megabytes == 0) return;
+    std::thread([seconds, megabytes, atstop]() {
+        const auto deadline = steady_clock::now() + std::chrono::seconds(seconds);
+        while (true) {
+            std::this_thread::sleep_for(milliseconds(100));
+            if (seconds > 0 && steady_clock::now() >= deadline) {
+                raise(alarm, "time limit of " + std::to_string(seconds) + " s exceeded");
+                break;
+            }
+            if (megabytes > 0 && resident() > megabytes) {
+                raise(alarm, "memory limit of " + std::to_string(megabytes) + " MB exceeded");
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(GRACE));
+        atstop(report(-1)); // no check point was reached
+    }).detach();
+}
+
+void Watchdog::alert(const std::string& why) {
+    raise(alarm, why);
+}
+
+void Watchdog::halt(const std::string& why) {
+    raise(alarm, why);
+    stop(-1);
+}
+
+void Watchdog::reset() {
+    std::lock_guard<std::mutex> lock(writing);
+    alarm.store(false, std::memory_order_relaxed);
+    reason = "";
+}
+
+void Watchdog::usage(size_t nodes, size_t size) {
+    filled.store(nodes, std::memory_order_relaxed);
+    total.store(size, std::memory_order_relaxed);
+}
+
+void Watchdog::phase(const char* name, const char* what) {
+    current = name;
+    unit = what;
+}
+
+std::string Watchdog::report(int position) {
+    std::ostringstream s;
+    {
+        std::lock_guard<std::mutex> lock(writing);
+        s << "Stopped (" << reason << ") in phase: " << current.load();
+    }
+    if (position >= 0) s << ", at " << unit.load() << " " << position;
+    if (STATISTICS) s << ", peak " << PEAK << " BDD nodes";
+    if (total > 0) s << ", BDD table " << filled << " of " << total << " nodes at the last gc";
+    s << ", " << resident() << " MB resident";
+    return s.str();
+}
+
+void Watchdog::stop(int position) {
+    throw Stopped(report(position));
+}
@@ -0,0 +1,48 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <functional>
+#include <atomic>
+#include <string>
+#include <stdexcept>
+
+// Limits on the running time (-timeout) and resident memory (-memlimit).
+// A watchdog thread only raises an alarm. The solver notices it at check
+// points between gates, blocks and the steps of transformations, where it
+// throws Stopped, with a report of the phase it reached (the command line
+// tool prints UNKNOWN then). When no check point is reached within a grace
+// period (e.g. in one huge BDD operation), the watchdog calls atstop, which
+// must end the process. Other parts, like the BDD packages, can raise the
+// alarm as well, or stop at once. The reason is written before the alarm is
+// raised (release), and check points notice it with acquire.
+
+class Stopped : public std::runtime_error {
+    public:
+        Stopped(const std::string& report) : std::runtime_error(report) { }
+};
+
+class Watchdog {
+    public:
+        // start the thread, if a limit is set; atstop gets the report
+        static void start(int seconds, int megabytes, std::function<void(const std::string&)> atstop);
+        // the current phase, and what its check points count (string literals)
+        static void phase(const char* name, const char* unit="step");
+        static void check(int position=-1) {
+            if (alarm.load(std::memory_order_acquire)) stop(position);
+        }
+        static void alert(const std::string& why);              // stop at the next check point
+        [[noreturn]] static void halt(const std::string& why);  // stop now
+        static void reset();                                    // clear the alarm, to go on after a stop
+        // the fill of the BDD table after the last gc, for the report
+        static void usage(size_t filled, size_t total);
+
+    private:
+        static std::atomic<bool> alarm;
+        [[noreturn]] static void stop(int position);            // throws Stopped
+        static std::string report(int position);
+};
+
+#endif // WATCHDOG_H
@@ -0,0 +1,257 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <functional>
+#include <cassert>
+
+#include "zdd.hpp"
+
+constexpr uint32_t LEAF = UINT32_MAX;  // variable of the terminals, below all others
+
+static inline uint32_t zvar(int lit) { return lit > 0 ? 2*lit : 2*(-lit)+1; }
+static inline int zlit(uint32_t v)   { return v%2==0 ? v/2 : -(int)(v/2); }
+
+Zdd::Zdd() : nodes({{LEAF, EMPTY, EMPTY}, {LEAF, BASE, BASE}}) { }
+
+Zdd::Node Zdd::mk(uint32_t v, Node lo, Node hi) {
+    if (hi == EMPTY) return lo; // zero-suppression
+    auto [it, fresh] = unique.try_emplace(Key({v, lo, hi}), nodes.size());
+    if (fresh) nodes.push_back({v, lo, hi});
+    return it->second;
+}
+
+Zdd::Node Zdd::clause(const std::vector<int>& literals) {
+    std::set<uint32_t> vars;
+    for (int lit : literals) {
+        if (vars.count(zvar(-lit)) > 0) return EMPTY; // tautology
+        vars.insert(zvar(lit));
+    }
+    Node z = BASE;
+    for (auto it=vars.rbegin(); it!=vars.rend(); it++)
+        z = mk(*it, EMPTY, z);
+    return z;
+}
+
+Zdd::Node Zdd::unite(Node a, Node b) {
+    if (a == EMPTY || a == b) return b;
+    if (b == EMPTY) return a;
+    if (a > b) std::swap(a, b);
+    Key key({UNITE, a, b});
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+    Node result;
+    if (var(a) < var(b))
+        result = mk(var(a), unite(lo(a), b), hi(a));
+    else if (var(b) < var(a))
+        result = mk(var(b), unite(a, lo(b)), hi(b));
+    else
+        result = mk(var(a), unite(lo(a), lo(b)), unite(hi(a), hi(b)));
+    cache[key] = result;
+    return result;
+}
+
+// Both literals of a variable are split off together, so that clauses
+// with x and with -x are never combined.
+Zdd::Node Zdd::product(Node a, Node b) {
+    if (a == EMPTY || b == EMPTY) return EMPTY;
+    if (a == BASE) return b;
+    if (b == BASE) return a;
+    if (a > b) std::swap(a, b);
+    Key key({PRODUCT, a, b});
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+    const uint32_t pos = std::min(var(a), var(b)) & ~1u;
+    const uint32_t neg = pos + 1;
+    Node a0 = a, a1 = EMPTY, a2 = EMPTY;
+    Node b0 = b, b1 = EMPTY, b2 = EMPTY;
+    if (var(a0) == pos) { a1 = hi(a0); a0 = lo(a0); }
+    if (var(a0) == neg) { a2 = hi(a0); a0 = lo(a0); }
+    if (var(b0) == pos) { b1 = hi(b0); b0 = lo(b0); }
+    if (var(b0) == neg) { b2 = hi(b0); b0 = lo(b0); }
+    Node r0 = product(a0, b0);
+    Node r1 = unite(unite(product(a1, b0), product(a0, b1)), product(a1, b1));
+    Node r2 = unite(unite(product(a2, b0), product(a0, b2)), product(a2, b2));
+    Node result = mk(pos, mk(neg, r0, r2), r1);
+    cache[key] = result;
+    return result;
+}
+
+bool Zdd::hasEmpty(Node z) const {
+    while (var(z) != LEAF) z = lo(z);
+    return z == BASE;
+}
+
+Zdd::Node Zdd::diff(Node a, Node b) {
+    if (a == EMPTY || a == b) return EMPTY;
+    if (b == EMPTY) return a;
+    if (hasEmpty(b)) return EMPTY;
+    if (a == BASE) return BASE;
+    Key key({DIFF, a, b});
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+    const uint32_t v = std::min(var(a), var(b));
+    Node a0 = a, a1 = EMPTY, b0 = b, b1 = EMPTY;
+    if (var(a) == v) { a0 = lo(a); a1 = hi(a); }
+    if (var(b) == v) { b0 = lo(b); b1 = hi(b); }
+    Node result = mk(v, diff(a0, b0), diff(diff(a1, b0), b1));
+    cache[key] = result;
+    return result;
+}
+
+Zdd::Node Zdd::subtract(Node a, Node b) {
+    if (a == EMPTY || a == b) return EMPTY;
+    if (b == EMPTY) return a;
+    if (var(a) == LEAF) return hasEmpty(b) ? EMPTY : a;
+    Key key({SUBTRACT, a, b});
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+    Node result;
+    if (var(a) < var(b))
+        result = mk(var(a), subtract(lo(a), b), hi(a));
+    else if (var(b) < var(a))
+        result = subtract(a, lo(b));
+    else
+        result = mk(var(a), subtract(lo(a), lo(b)), subtract(hi(a), hi(b)));
+    cache[key] = result;
+    return result;
+}
+
+Zdd::Node Zdd::minimal(Node z) {
+    if (var(z) == LEAF) return z;
+    Key key({MINIMAL, z, 0});
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+    Node m0 = minimal(lo(z));
+    Node result = mk(var(z), m0, diff(minimal(hi(z)), m0));
+    cache[key] = result;
+    return result;
+}
+
+Zdd::Node Zdd::without(Node z, uint32_t v) {
+    if (var(z) > v) return z;
+    if (var(z) == v) return lo(z);
+    Key key({WITHOUT, z, v});
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+    Node result = mk(var(z), without(lo(z), v), without(hi(z), v));
+    cache[key] = result;
+    return result;
+}
+
+Zdd::Node Zdd::with(Node z, uint32_t v) {
+    if (var(z) > v) return EMPTY;
+    if (var(z) == v) return hi(z);
+    Key key({WITH, z, v});
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+    Node result = mk(var(z), with(lo(z), v), with(hi(z), v));
+    cache[key] = result;
+    return result;
+}
+
+// Davis-Putnam: replace the clauses on x by their non-tautological resolvents
+Zdd::Node Zdd::resolve(Node z, int x) {
+    Node z0 = without(z, zvar(x));
+    Node pos = with(z, zvar(x));
+    Node neg = with(z0, zvar(-x));
+    Node rest = without(z0, zvar(-x));
+    if (pos == EMPTY || neg == EMPTY) return rest; // pure literal
+    Node resolvents = diff(minimal(product(pos, neg)), rest);
+    return unite(diff(rest, resolvents), resolvents);
+}
+
+// x is innermost, so it can be removed from all clauses
+Zdd::Node Zdd::reduce(Node z, int x) {
+    Node z0 = without(z, zvar(x));
+    Node pos = with(z, zvar(x));
+    Node neg = with(z0, zvar(-x));
+    Node rest = without(z0, zvar(-x));
+    return minimal(unite(rest, unite(pos, neg)));
+}
+
+// In one pass: the clauses through node n with variable v are the paths
+// from z to n, each extended by the clauses of hi(n). Children are made
+// before their parents, so decreasing node numbers are a topological order.
+std::unordered_map<int, std::pair<double,double>> Zdd::occurrences(Node z) {
+    std::unordered_map<int, std::pair<double,double>> result;
+    std::unordered_map<Node, double> paths({{z, 1}});
+    std::set<Node, std::greater<Node>> todo({z});
+    while (!todo.empty()) {
+        Node n = *todo.begin(); todo.erase(todo.begin());
+        if (var(n) == LEAF) continue;
+        const double p = paths[n];
+        const int lit = zlit(var(n));
+        double c = p * clauseCount(hi(n));
+        if (lit > 0) result[lit].first += c; else result[-lit].second += c;
+        paths[lo(n)] += p; todo.insert(lo(n));
+        paths[hi(n)] += p; todo.insert(hi(n));
+    }
+    return result;
+}
+
+size_t Zdd::nodeCount(Node z) const {
+    std::vector<bool> visited(nodes.size(), false);
+    std::vector<Node> todo({z});
+    size_t count = 0;
+    while (!todo.empty()) {
+        Node n = todo.back(); todo.pop_back();
+        if (visited[n]) continue;
+        visited[n] = true;
+        count++;
+        if (var(n) == LEAF) continue;
+        todo.push_back(lo(n));
+        todo.push_back(hi(n));
+    }
+    return count;
+}
+
+double Zdd::clauseCount(Node z) {
+    if (var(z) == LEAF) return (z == BASE ? 1 : 0);
+    auto it = counts.find(z);
+    if (it != counts.end()) return it->second;
+    double result = clauseCount(lo(z)) + clauseCount(hi(z));
+    counts[z] = result;
+    return result;
+}
+
+std::vector<std::vector<int>> Zdd::clauses(Node z) const {
+    std::vector<std::vector<int>> result;
+    std::vector<int> current;
+    auto walk = [&](auto& walk, Node n)->void {
+        if (n == BASE) result.push_back(current);
+        if (var(n) == LEAF) return;
+        walk(walk, lo(n));
+        current.push_back(zlit(var(n)));
+        walk(walk, hi(n));
+        current.pop_back();
+    };
+    walk(walk, z);
+    return result;
+}
+
+Zdd::Node Zdd::copy(const std::vector<ZNode>& from, Node z, std::unordered_map<Node,Node>& done) {
+    if (z == EMPTY || z == BASE) return z;
+    auto it = done.find(z);
+    if (it != done.end()) return it->second;
+    Node result = mk(from[z].var, copy(from, from[z].lo, done), copy(from, from[z].hi, done));
+    done[z] = result;
+    return result;
+}
+
+void Zdd::flush() {
+    cache.clear();
+    counts.clear();
+}
+
+Zdd::Node Zdd::compact(Node z) {
+    std::vector<ZNode> old;
+    old.swap(nodes);
+    nodes = {old[EMPTY], old[BASE]};
+    unique.clear();
+    flush();
+    std::unordered_map<Node,Node> done;
+    return copy(old, z, done);
+}
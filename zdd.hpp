@@ -0,0 +1,85 @@
+// (c) Jaco van de Pol
+// Aarhus University
+
+#ifndef ZDD_H
+#define ZDD_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+class Zdd {
+
+// A Zdd stores sets of clauses as zero-suppressed decision diagrams.
+// Literal x is ZDD variable 2x, literal -x is ZDD variable 2x+1, so both
+// literals of a variable are adjacent in the order. A node (v,lo,hi) denotes
+// the clauses of lo, together with the clauses of hi extended with v.
+// Nodes are never freed individually: compact() drops all unreachable nodes.
+
+public:
+    typedef uint32_t Node;
+    static constexpr Node EMPTY = 0;    // no clauses at all (true)
+    static constexpr Node BASE  = 1;    // only the empty clause (false)
+
+    Zdd();
+
+    Node clause(const std::vector<int>& literals); // single clause, EMPTY if tautology
+    Node unite(Node a, Node b);                     // union
+    Node minimal(Node z);                           // remove subsumed clauses
+
+    // Quantifier elimination for a variable x in the innermost block.
+    // Both expect and return a clause set without subsumed clauses.
+    Node resolve(Node z, int x);        // exists x: all resolvents on x
+    Node reduce(Node z, int x);         // forall x: universal reduction
+
+    Node subtract(Node a, Node b);      // clauses of a that are not in b
+
+    // for each variable x: the number of clauses with x and with -x
+    std::unordered_map<int, std::pair<double,double>> occurrences(Node z);
+
+    bool hasEmpty(Node z) const;        // contains the empty clause
+    size_t nodeCount(Node z) const;     // including terminals
+    double clauseCount(Node z);
+    std::vector<std::vector<int>> clauses(Node z) const;
+
+    Node compact(Node z);               // keep only the nodes reachable from z
+    void flush();                       // empty the operation cache
+    size_t size() const                 { return nodes.size(); }
+
+private:
+    struct ZNode {
+        uint32_t var;
+        Node lo;
+        Node hi;
+    };
+    std::vector<ZNode> nodes;
+
+    struct Key {
+        uint32_t a, b, c;
+        bool operator==(const Key& k) const { return a==k.a && b==k.b && c==k.c; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            uint64_t h = (k.a * 0x9E3779B97F4A7C15ULL) ^ k.b;
+            h = (h * 0xBF58476D1CE4E5B9ULL) ^ k.c;
+            return h ^ (h >> 29);
+        }
+    };
+    enum Op : uint32_t {UNITE, PRODUCT, DIFF, SUBTRACT, MINIMAL, WITH, WITHOUT};
+    std::unordered_map<Key, Node, KeyHash> unique;  // keyed by (var,lo,hi)
+    std::unordered_map<Key, Node, KeyHash> cache;   // keyed by (op,a,b)
+    std::unordered_map<Node, double> counts;
+
+    uint32_t var(Node z) const  { return nodes[z].var; }
+    Node lo(Node z) const       { return nodes[z].lo; }
+    Node hi(Node z) const       { return nodes[z].hi; }
+
+    Node mk(uint32_t v, Node lo, Node hi);
+    Node product(Node a, Node b);       // pairwise unions, except tautologies
+    Node diff(Node a, Node b);          // clauses of a not subsumed by a clause of b
+    Node without(Node z, uint32_t v);   // clauses without v
+    Node with(Node z, uint32_t v);      // clauses with v, removing v
+    Node copy(const std::vector<ZNode>& from, Node z, std::unordered_map<Node,Node>& done);
+};
+
+#endif // ZDD_H